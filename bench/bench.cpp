@@ -0,0 +1,702 @@
+/*
+ * bench.cpp: Benchmark for the xmltv2vdr parse, write and import stages
+ *
+ * Runs the plugin sources against the VDR stubs with synthetic XMLTV
+ * data and prints one "<stage> <counter> <value>" line per result.
+ *
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "../xmltv2vdr.h"
+#include "../debug.h"
+#include "genxmltv.h"
+
+#define BENCH_SOURCE "bench"
+#define BENCH_FLAGS (USE_SHORTTEXT|USE_LONGTEXT|USE_COUNTRYDATE|USE_CATEGORIES|USE_CREDITS| \
+                     USE_RATING|USE_STARRATING|USE_VIDEO|USE_AUDIO|USE_SEASON| \
+                     CREDITS_ACTORS|CREDITS_DIRECTORS)
+#define BENCH_TRANSPONDER 8 // channels per transponder
+#define BENCH_SECTION 4 // events per eit section
+
+static void resetpeak()
+{
+    // resets VmHWM (linux >= 4.0), so the peak is per stage
+    int fd=open("/proc/self/clear_refs",O_WRONLY);
+    if (fd==-1) return;
+    if (write(fd,"5",1)!=1) {};
+    close(fd);
+}
+
+static long peakrss()
+{
+    long kb=0;
+    FILE *f=fopen("/proc/self/status","r");
+    if (f)
+    {
+        char line[256];
+        while (fgets(line,sizeof(line),f))
+        {
+            if (!strncmp(line,"VmHWM:",6))
+            {
+                kb=atol(line+6);
+                break;
+            }
+        }
+        fclose(f);
+    }
+    if (!kb)
+    {
+        struct rusage usage;
+        if (!getrusage(RUSAGE_SELF,&usage)) kb=usage.ru_maxrss;
+    }
+    return kb;
+}
+
+class cBench : public cEPGExecutor
+{
+private:
+    cGlobals *g;
+    cEPGSource *source;
+    tGenOptions *options;
+    int flags;
+    int append;
+    int rounds;
+    int maxp99;
+    const char *golden;
+    bool writegolden;
+    int result;
+    char *doc;
+    size_t doclen;
+    uint64_t start;
+    void begin();
+    void report(const char *Stage, int Items, size_t Bytes);
+    bool generate();
+    bool parse();
+    bool getsql();
+    void buildschedules();
+    bool import();
+    char *dump(size_t *Len);
+    bool compare();
+    bool handler();
+protected:
+    virtual void Action();
+public:
+    cBench(cGlobals *Global, cEPGSource *Source, tGenOptions *Options, int Flags, int Append, int Rounds,
+           int MaxP99);
+    void SetGolden(const char *File, bool Write)
+    {
+        golden=File;
+        writegolden=Write;
+    }
+    ~cBench();
+    int Result()
+    {
+        return result;
+    }
+};
+
+cBench::cBench(cGlobals *Global, cEPGSource *Source, tGenOptions *Options, int Flags, int Append, int Rounds,
+               int MaxP99) :
+    cEPGExecutor(Global->EPGSources())
+{
+    g=Global;
+    source=Source;
+    options=Options;
+    flags=Flags;
+    append=Append;
+    rounds=Rounds;
+    maxp99=MaxP99;
+    golden=NULL;
+    writegolden=false;
+    result=0;
+    doc=NULL;
+    doclen=0;
+    start=0;
+}
+
+cBench::~cBench()
+{
+    free(doc);
+}
+
+void cBench::begin()
+{
+    resetpeak();
+    start=StatNow();
+}
+
+void cBench::report(const char *Stage, int Items, size_t Bytes)
+{
+    uint64_t usecs=StatNow()-start;
+    double secs=usecs ? (double) usecs/1000000 : 1e-6;
+    printf("%s usec %" PRIu64 "\n",Stage,usecs);
+    printf("%s items %i\n",Stage,Items);
+    printf("%s items_per_sec %.0f\n",Stage,Items/secs);
+    if (Bytes)
+    {
+        printf("%s bytes %lu\n",Stage,(unsigned long) Bytes);
+        printf("%s mb_per_sec %.2f\n",Stage,Bytes/secs/(1024*1024));
+    }
+    printf("%s peak_rss_kb %li\n",Stage,peakrss());
+    fflush(stdout);
+}
+
+bool cBench::generate()
+{
+    begin();
+    cGenXMLTV gen(options);
+    doc=gen.XMLTV(&doclen);
+    if (!doc)
+    {
+        fprintf(stderr,"out of memory\n");
+        return false;
+    }
+    int cnt=0;
+    for (const char *p=doc; (p=strstr(p,"<programme "))!=NULL; p++) cnt++;
+    report("generate",cnt,doclen);
+    return true;
+}
+
+bool cBench::parse()
+{
+    cParse parser(source,g);
+    source->Stats()->StartGrab();
+    begin();
+    int ret=parser.Process(*this,doc,doclen);
+    cSourceStats *stats=source->Stats();
+    report("parse",stats->Get(STAT_ROWSINSERTED)+stats->Get(STAT_ROWSUPDATED),doclen);
+    if (ret)
+    {
+        fprintf(stderr,"parse returned %i\n",ret);
+        return false;
+    }
+    return true;
+}
+
+bool cBench::getsql()
+{
+    // same data as in the parse stage, without libxml2 and sqlite3
+    cGenXMLTV gen(options);
+    cXMLTVEvent xevent;
+    char *desc=(char *) malloc(options->descsize+1);
+    if (!desc) return false;
+    for (int i=0; i<options->descsize; i++) desc[i]=(i % 9==8) ? ' ' : 'a'+(i % 26);
+    desc[options->descsize]=0;
+
+    begin();
+    int cnt=0;
+    size_t bytes=0;
+    char id[64];
+    for (int c=0; c<options->channels; c++)
+    {
+        gen.Reset(c);
+        cGenXMLTV::ChannelID(c,id,sizeof(id));
+        tGenProgramme p;
+        while (gen.Next(&p))
+        {
+            xevent.Clear();
+            xevent.SetStartTime(p.start);
+            xevent.SetDuration(p.duration);
+            xevent.SetTitle(p.title);
+            xevent.SetShortText(p.shorttext);
+            xevent.SetDescription(desc);
+            xevent.SetYear(p.year);
+            xevent.AddCategory(cGenXMLTV::Category(p.category));
+            for (int i=0; i<options->credits; i++) xevent.AddCredits("actor","Anna O'Neil");
+            xevent.SetSeason(p.season);
+            xevent.SetEpisode(p.episode);
+            xevent.CreateEventID(p.start);
+            char *isql,*usql;
+            xevent.GetSQL(BENCH_SOURCE,0,id,&isql,&usql);
+            if (isql) bytes+=strlen(isql);
+            if (usql) bytes+=strlen(usql);
+            cnt++;
+        }
+    }
+    report("getsql",cnt,bytes);
+    free(desc);
+    return true;
+}
+
+void cBench::buildschedules()
+{
+    // EIT events for the generated programmes, most of them match exactly,
+    // the others are shifted, renamed or missing
+    cGenXMLTV gen(options);
+    unsigned int rnd=options->seed ? options->seed : 1;
+    cSchedulesLock lock(true);
+    cSchedules *schedules=(cSchedules *) cSchedules::Schedules(lock);
+    if (!schedules) return;
+    char name[64],id[64];
+    for (int c=0; c<options->channels; c++)
+    {
+        cGenXMLTV::ChannelName(c,name,sizeof(name));
+        cGenXMLTV::ChannelID(c,id,sizeof(id));
+        cChannel *channel=new cChannel(c+1,name,tChannelID::FromString(id));
+        Channels.Add(channel);
+        cSchedule *schedule=schedules->AddSchedule(channel->GetChannelID());
+
+        gen.Reset(c);
+        tGenProgramme p;
+        tEventID eventid=1;
+        while (gen.Next(&p))
+        {
+            rnd^=rnd<<13;
+            rnd^=rnd>>17;
+            rnd^=rnd<<5;
+            int kind=rnd % 100;
+            if (kind>=95) continue; // no eit event
+            time_t st=p.start;
+            char title[80];
+            strcpy(title,p.title);
+            if (kind>=70 && kind<85)
+            {
+                st+=((rnd>>8) % 2 ? 60 : -60)*(int) (1+(rnd>>12) % 10);
+            }
+            else if (kind>=85)
+            {
+                // other first word, the remaining words still match
+                const char *sp=strchr(p.title,' ');
+                snprintf(title,sizeof(title),"Neu%s",sp ? sp : "");
+            }
+            cEvent *event=new cEvent(eventid++);
+            event->SetTitle(title);
+            event->SetStartTime(st);
+            event->SetDuration(p.duration);
+            event->SetTableID(0x50);
+            event->SetVersion(1);
+            schedule->AddEvent(event);
+        }
+        schedule->Sort();
+    }
+}
+
+bool cBench::import()
+{
+    buildschedules();
+    begin();
+    int ret=source->Import(*this);
+    cSourceStats *stats=source->Stats();
+    int cnt=0;
+    for (int i=STAT_MATCHEITID; i<STAT_MATCHNONE; i++) cnt+=stats->Get(i);
+    report("import",cnt,0);
+    if (ret)
+    {
+        fprintf(stderr,"import returned %i\n",ret);
+        return false;
+    }
+    return true;
+}
+
+static void dumpstring(FILE *f, const char *Name, const char *Value)
+{
+    // one line per value, newlines and backslashes escaped
+    fprintf(f,"  %s ",Name);
+    if (!Value)
+    {
+        fputs("-\n",f);
+        return;
+    }
+    for (const char *p=Value; *p; p++)
+    {
+        switch (*p)
+        {
+        case '\n':
+            fputs("\\n",f);
+            break;
+        case '\\':
+            fputs("\\\\",f);
+            break;
+        default:
+            fputc(*p,f);
+            break;
+        }
+    }
+    fputc('\n',f);
+}
+
+char *cBench::dump(size_t *Len)
+{
+    // canonical text of the imported schedules, times relative to the
+    // start of the generated data, so runs at different times compare
+    char *buf=NULL;
+    FILE *f=open_memstream(&buf,Len);
+    if (!f) return NULL;
+    fprintf(f,"options %i %i %i %i %u %i %i\n",options->channels,options->days,options->descsize,
+            options->credits,options->seed,flags,append);
+    cSchedulesLock lock;
+    const cSchedules *schedules=cSchedules::Schedules(lock);
+    for (int c=0; schedules && (c<options->channels); c++)
+    {
+        cChannel *channel=Channels.GetByNumber(c+1);
+        if (!channel) continue;
+        const cSchedule *schedule=schedules->GetSchedule(channel);
+        if (!schedule) continue;
+        fprintf(f,"channel %s\n",*channel->GetChannelID().ToString());
+        for (const cEvent *e=schedule->Events()->First(); e; e=schedule->Events()->Next(e))
+        {
+            fprintf(f,"event %u %li %i\n",e->EventID(),(long) (e->StartTime()-options->start),
+                    e->Duration());
+            dumpstring(f,"title",e->Title());
+            dumpstring(f,"shorttext",e->ShortText());
+            dumpstring(f,"description",e->Description());
+            fprintf(f,"  contents");
+            for (int i=0; i<MaxEventContents; i++) fprintf(f," %02x",e->Contents(i));
+            fprintf(f,"\n  rating %i\n",e->ParentalRating());
+        }
+    }
+    if (fclose(f))
+    {
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+bool cBench::compare()
+{
+    // the import result must be byte-identical to the golden file
+    if (!golden) return true;
+    size_t len;
+    begin();
+    char *out=dump(&len);
+    if (!out)
+    {
+        fprintf(stderr,"out of memory\n");
+        return false;
+    }
+    if (writegolden)
+    {
+        FILE *f=fopen(golden,"w");
+        bool ok=f && (fwrite(out,1,len,f)==len);
+        if (f && fclose(f)) ok=false;
+        if (!ok) fprintf(stderr,"failed to write %s\n",golden);
+        report("golden",0,len);
+        free(out);
+        return ok;
+    }
+
+    char *ref=NULL;
+    size_t reflen=0;
+    FILE *f=fopen(golden,"r");
+    if (f)
+    {
+        struct stat st;
+        if (!fstat(fileno(f),&st) && (ref=(char *) malloc(st.st_size+1)))
+        {
+            reflen=fread(ref,1,st.st_size,f);
+            ref[reflen]=0;
+        }
+        fclose(f);
+    }
+    if (!ref)
+    {
+        fprintf(stderr,"cannot read %s\n",golden);
+        free(out);
+        return false;
+    }
+    size_t pos=0;
+    int line=1;
+    while ((pos<len) && (pos<reflen) && (out[pos]==ref[pos]))
+    {
+        if (out[pos]=='\n') line++;
+        pos++;
+    }
+    bool same=(pos==len) && (pos==reflen);
+    report("golden",0,len);
+    printf("golden result %s\n",same ? "identical" : "differs");
+    if (!same)
+    {
+        size_t bol=pos;
+        while (bol && (out[bol-1]!='\n')) bol--;
+        int olen=strcspn(out+bol,"\n");
+        int rlen=(bol<reflen) ? (int) strcspn(ref+bol,"\n") : 0;
+        fprintf(stderr,"%s:%i differs\n- %.*s\n+ %.*s\n",golden,line,rlen,
+                (bol<reflen) ? ref+bol : "",olen,out+bol);
+    }
+    free(ref);
+    free(out);
+    return same;
+}
+
+bool cBench::handler()
+{
+    // replays the imported schedules like the eit thread does: every round
+    // scans all transponders, each section holds a few events which are
+    // all seen again in the next round
+    if (rounds<1) return true;
+    g->HandlerStats()->Reset();
+    cEPGHandler handler(g);
+    begin();
+    int cnt=0;
+    for (int r=0; r<rounds; r++)
+    {
+        for (int t=0; t<options->channels; t+=BENCH_TRANSPONDER)
+        {
+            cSchedulesLock lock(true);
+            cSchedules *schedules=(cSchedules *) cSchedules::Schedules(lock);
+            if (!schedules) return false;
+            for (int c=t; (c<t+BENCH_TRANSPONDER) && (c<options->channels); c++)
+            {
+                cChannel *channel=Channels.GetByNumber(c+1);
+                if (!channel) continue;
+                cSchedule *schedule=(cSchedule *) schedules->GetSchedule(channel);
+                if (!schedule) continue;
+                int insection=0;
+                for (cEvent *e=schedule->Events()->First(); e; e=schedule->Events()->Next(e))
+                {
+                    if (!insection && handler.IgnoreChannel(channel)) break;
+                    char stext[32],descr[128];
+                    snprintf(stext,sizeof(stext),"Folge %u",e->EventID());
+                    if (e->Description() && strncmp(e->Description(),"EIT ",4))
+                    {
+                        // broadcasters send the first words of the xmltv text
+                        snprintf(descr,48,"%s",e->Description());
+                        char *sp=strrchr(descr,' ');
+                        if (sp && (sp!=descr)) *sp=0;
+                    }
+                    else
+                    {
+                        snprintf(descr,sizeof(descr),"EIT description of '%s'",e->Title());
+                    }
+                    if (!handler.SetShortText(e,stext)) e->SetShortText(stext);
+                    if (!handler.SetDescription(e,descr)) e->SetDescription(descr);
+                    handler.HandleEvent(e);
+                    cnt++;
+                    if (++insection==BENCH_SECTION)
+                    {
+                        handler.SortSchedule(schedule);
+                        insection=0;
+                    }
+                }
+                if (insection) handler.SortSchedule(schedule);
+            }
+        }
+    }
+    report("handler",cnt,0);
+
+    cString output("");
+    g->HandlerStats()->Print(output);
+    printf("%s",*output);
+    if (maxp99>0)
+    {
+        uint64_t p99=g->HandlerStats()->Percentile(HANDLER_HANDLEEVENT,0.99);
+        if (p99>(uint64_t) maxp99)
+        {
+            fprintf(stderr,"handleevent p99 %" PRIu64 " usec exceeds %i usec\n",p99,maxp99);
+            return false;
+        }
+    }
+    return true;
+}
+
+void cBench::Action()
+{
+    result=1;
+    if (!generate()) return;
+    if (!parse()) return;
+    if (!getsql()) return;
+    if (!import()) return;
+
+    cString output("");
+    source->Stats()->Print(BENCH_SOURCE,output);
+    printf("%s",*output);
+    if (!compare()) return;
+    if (!handler()) return;
+    result=0;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+// same labels as set by the plugin, without translation
+static const char *textlabels[]=
+{
+    "country","year","originaltitle","category","actor","adapter","commentator","composer",
+    "director","editor","guest","presenter","producer","writer","video","blacknwhite","audio",
+    "dolby","dolbydigital","bilingual","review","starrating","season","episode","episodeoverall",
+    NULL
+};
+
+static void usage(const char *Name)
+{
+    fprintf(stderr,"usage: %s [options]\n"
+            "  -c N   number of channels (default 20)\n"
+            "  -d N   days per channel (default 7)\n"
+            "  -s N   description size in bytes (default 600)\n"
+            "  -k N   actors per programme (default 8)\n"
+            "  -r N   random seed (default 1)\n"
+            "  -t N   import threads (default 1)\n"
+            "  -f N   mapping flags (default %i)\n"
+            "  -a N   map the last N channels with the append option (default 0)\n"
+            "  -e N   eit rounds through the epg handler (default 3)\n"
+            "  -p N   fail if the handleevent p99 exceeds N usec\n"
+            "  -g F   compare the imported events with the golden file F\n"
+            "  -G F   write the imported events to the golden file F\n"
+            "  -o F   write the xmltv data to F and exit\n"
+            "  -K     keep the temporary epg.db\n"
+            "  -v     more log output (repeat for debug)\n",Name,BENCH_FLAGS);
+}
+
+int main(int argc, char *argv[])
+{
+    tGenOptions options;
+    options.channels=20;
+    options.days=7;
+    options.descsize=600;
+    options.credits=8;
+    options.seed=1;
+    options.start=(time(NULL)/3600+1)*3600; // no event has ended before the import
+    int threads=1;
+    int flags=BENCH_FLAGS;
+    int append=0;
+    const char *outfile=NULL;
+    bool keep=false;
+    int rounds=3;
+    int maxp99=0;
+    const char *golden=NULL;
+    bool writegolden=false;
+
+    int c;
+    while ((c=getopt(argc,argv,"c:d:s:k:r:t:f:a:e:p:g:G:o:Kvh"))!=-1)
+    {
+        switch (c)
+        {
+        case 'c':
+            options.channels=atoi(optarg);
+            break;
+        case 'd':
+            options.days=atoi(optarg);
+            break;
+        case 's':
+            options.descsize=atoi(optarg);
+            break;
+        case 'k':
+            options.credits=atoi(optarg);
+            break;
+        case 'r':
+            options.seed=strtoul(optarg,NULL,10);
+            break;
+        case 't':
+            threads=atoi(optarg);
+            break;
+        case 'f':
+            flags=strtol(optarg,NULL,0);
+            break;
+        case 'a':
+            append=atoi(optarg);
+            break;
+        case 'e':
+            rounds=atoi(optarg);
+            break;
+        case 'p':
+            maxp99=atoi(optarg);
+            break;
+        case 'g':
+        case 'G':
+            golden=optarg;
+            writegolden=(c=='G');
+            break;
+        case 'o':
+            outfile=optarg;
+            break;
+        case 'K':
+            keep=true;
+            break;
+        case 'v':
+            SysLogLevel++;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.channels<1 || options.days<1 || options.descsize<0 || options.credits<0 ||
+            append<0 || append>options.channels)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (outfile)
+    {
+        cGenXMLTV gen(&options);
+        size_t len;
+        char *doc=gen.XMLTV(&len);
+        FILE *f=fopen(outfile,"w");
+        if (!doc || !f || fwrite(doc,1,len,f)!=len)
+        {
+            fprintf(stderr,"failed to write %s\n",outfile);
+            if (f) fclose(f);
+            free(doc);
+            return 1;
+        }
+        fclose(f);
+        free(doc);
+        return 0;
+    }
+
+    char dir[]="/tmp/xmltv2vdr-bench.XXXXXX";
+    if (!mkdtemp(dir))
+    {
+        fprintf(stderr,"cannot create temporary directory\n");
+        return 1;
+    }
+    char *epgfile=NULL;
+    if (asprintf(&epgfile,"%s/epg.db",dir)==-1) return 1;
+
+    cParse::InitLibXML();
+    int ret;
+    {
+        cGlobals g;
+        g.SetEPGFile(epgfile);
+        g.SetConfDir(dir);
+        g.SetImportThreads(threads);
+
+        char name[64],id[64],mapping[128];
+        for (int i=0; i<options.channels; i++)
+        {
+            cGenXMLTV::ChannelName(i,name,sizeof(name));
+            cGenXMLTV::ChannelID(i,id,sizeof(id));
+            int chflags=(i>=options.channels-append) ? (flags|OPT_APPEND) : flags;
+            snprintf(mapping,sizeof(mapping),"0;%i;%s",chflags,id);
+            g.EPGMappings()->Add(new cEPGMapping(name,mapping));
+        }
+        for (int i=0; textlabels[i]; i++)
+        {
+            g.TEXTMappings()->Add(new cTEXTMapping(textlabels[i],textlabels[i]));
+        }
+        g.PublishEPGMappings();
+
+        cEPGSource *source=new cEPGSource(BENCH_SOURCE,&g);
+        source->ChangeDaysInAdvance(options.days+1); // import window covers all data
+        g.EPGSources()->Add(source);
+
+        printf("options channels %i\noptions days %i\noptions descsize %i\noptions credits %i\n"
+               "options seed %u\noptions threads %i\noptions flags %i\noptions append %i\noptions rounds %i\n",
+               options.channels,options.days,options.descsize,options.credits,options.seed,g.ImportThreads(),
+               flags,append,rounds);
+
+        cBench bench(&g,source,&options,flags,append,rounds,maxp99);
+        bench.SetGolden(golden,writegolden);
+        bench.Start();
+        while (bench.Active()) cCondWait::SleepMs(20);
+        ret=bench.Result();
+    }
+    cParse::CleanupLibXML();
+
+    if (keep)
+    {
+        fprintf(stderr,"epg.db kept in %s\n",dir);
+    }
+    else
+    {
+        unlink(epgfile);
+        rmdir(dir);
+    }
+    free(epgfile);
+    return ret;
+}
@@ -0,0 +1,227 @@
+/*
+ * genxmltv.cpp: Synthetic XMLTV generator for the xmltv2vdr benchmark
+ *
+ * The programmes of a channel only depend on the options and the
+ * channel number, so the benchmark can build matching EIT schedules.
+ *
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genxmltv.h"
+
+static const char *words[]=
+{
+    "Abend", "Sturm", "Reise", "Garten", "Zeitgeschehen", "Morgen", "Stadt", "Leben",
+    "Wasser", "Berge", "Geschichte", "Nachbarn", "Familie", "Kommissar", "Spuren", "Welt",
+    "Geheimnis", "Sommer", "Winter", "Insel", "Hafen", "Küste", "Straße", "Brücke",
+    "Schatten", "Licht", "Feuer", "Wüste", "Dschungel", "Planet", "Sterne", "Nacht",
+    "Journal", "Magazin", "Wetter", "Nachrichten", "Report", "Spezial", "Thema", "Bilanz",
+    "Mörder", "Zeugen", "Tatort", "Akten", "Fälle", "Ermittler", "Gericht", "Urteil"
+};
+#define NUMWORDS (int) (sizeof(words)/sizeof(words[0]))
+
+static const char *categories[]=
+{
+    "Spielfilm", "Krimi", "Nachrichten", "Sport", "Kinder", "Dokumentation", "Serie", "Show"
+};
+#define NUMCATEGORIES (int) (sizeof(categories)/sizeof(categories[0]))
+
+static const char *firstnames[]=
+{
+    "Anna", "Peter", "Maria", "Thomas", "Julia", "Michael", "Laura", "Stefan"
+};
+static const char *lastnames[]=
+{
+    "Müller", "Schmidt", "Schneider", "Fischer", "Weber", "Meyer", "Wagner", "Becker"
+};
+
+cGenXMLTV::cGenXMLTV(const tGenOptions *Options)
+{
+    options=Options;
+    textrnd=options->seed ? options->seed : 1;
+    buf=NULL;
+    len=allocated=0;
+    Reset(0);
+}
+
+cGenXMLTV::~cGenXMLTV()
+{
+    free(buf);
+}
+
+unsigned int cGenXMLTV::random(unsigned int &State)
+{
+    // xorshift32, never zero
+    State^=State<<13;
+    State^=State>>17;
+    State^=State<<5;
+    return State;
+}
+
+const char *cGenXMLTV::word(unsigned int &State)
+{
+    return words[random(State) % NUMWORDS];
+}
+
+void cGenXMLTV::ChannelName(int Channel, char *Name, size_t Size)
+{
+    snprintf(Name,Size,"bench%i.de",Channel+1);
+}
+
+void cGenXMLTV::ChannelID(int Channel, char *ID, size_t Size)
+{
+    snprintf(ID,Size,"S19.2E-1-1000-%i",Channel+1);
+}
+
+const char *cGenXMLTV::Category(int Category)
+{
+    return categories[Category % NUMCATEGORIES];
+}
+
+void cGenXMLTV::Reset(int Channel)
+{
+    channel=Channel;
+    index=0;
+    rnd=(options->seed*2654435761u)^((unsigned int) (Channel+1)*40503u);
+    if (!rnd) rnd=1;
+    next=options->start;
+    end=options->start+options->days*86400;
+}
+
+bool cGenXMLTV::Next(tGenProgramme *Programme)
+{
+    if (next>=end) return false;
+    memset(Programme,0,sizeof(*Programme));
+    Programme->channel=channel;
+    Programme->index=index++;
+    Programme->start=next;
+    Programme->duration=(1+random(rnd) % 24)*300; // 5..120 min
+    next+=Programme->duration;
+
+    int nwords=2+random(rnd) % 3;
+    for (int i=0; i<nwords; i++)
+    {
+        if (i) strcat(Programme->title," ");
+        strcat(Programme->title,word(rnd));
+    }
+    snprintf(Programme->shorttext,sizeof(Programme->shorttext),"%s %s",word(rnd),word(rnd));
+    if (random(rnd) % 2)
+    {
+        Programme->season=1+random(rnd) % 10;
+        Programme->episode=1+random(rnd) % 24;
+    }
+    Programme->year=1960+random(rnd) % 60;
+    Programme->category=random(rnd) % NUMCATEGORIES;
+    return true;
+}
+
+bool cGenXMLTV::append(const char *Format, ...)
+{
+    for (;;)
+    {
+        va_list ap;
+        va_start(ap,Format);
+        int l=vsnprintf(buf ? buf+len : NULL,allocated-len,Format,ap);
+        va_end(ap);
+        if (l<0) return false;
+        if (len+l<allocated)
+        {
+            len+=l;
+            return true;
+        }
+        size_t newsize=allocated ? allocated*2 : 1024*1024;
+        while (newsize<=len+l) newsize*=2;
+        char *tmp=(char *) realloc(buf,newsize);
+        if (!tmp) return false;
+        buf=tmp;
+        allocated=newsize;
+    }
+}
+
+bool cGenXMLTV::appendtext(int Size)
+{
+    int l=0;
+    bool start=true;
+    while (l<Size)
+    {
+        const char *w=word(textrnd);
+        if (!append(start ? "%s" : " %s",w)) return false;
+        l+=strlen(w)+(start ? 0 : 1);
+        start=false;
+        if (!(random(textrnd) % 12))
+        {
+            if (!append(".")) return false;
+            l++;
+        }
+    }
+    return append(".");
+}
+
+char *cGenXMLTV::XMLTV(size_t *Len)
+{
+    len=0;
+    textrnd=options->seed ? options->seed : 1;
+    if (!append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<tv generator-info-name=\"genxmltv\">\n"))
+        return NULL;
+    char name[32];
+    for (int c=0; c<options->channels; c++)
+    {
+        ChannelName(c,name,sizeof(name));
+        if (!append("  <channel id=\"%s\">\n    <display-name>Bench %i</display-name>\n  </channel>\n",
+                    name,c+1)) return NULL;
+    }
+    for (int c=0; c<options->channels; c++)
+    {
+        ChannelName(c,name,sizeof(name));
+        Reset(c);
+        tGenProgramme p;
+        while (Next(&p))
+        {
+            char start[32],stop[32];
+            time_t stoptime=p.start+p.duration;
+            struct tm tm;
+            strftime(start,sizeof(start),"%Y%m%d%H%M%S +0000",gmtime_r(&p.start,&tm));
+            strftime(stop,sizeof(stop),"%Y%m%d%H%M%S +0000",gmtime_r(&stoptime,&tm));
+            if (!append("  <programme start=\"%s\" stop=\"%s\" channel=\"%s\">\n"
+                        "    <title lang=\"de\">%s</title>\n"
+                        "    <sub-title lang=\"de\">%s</sub-title>\n"
+                        "    <desc lang=\"de\">",start,stop,name,p.title,p.shorttext)) return NULL;
+            if (!appendtext(options->descsize)) return NULL;
+            if (!append("</desc>\n")) return NULL;
+            if (options->credits)
+            {
+                if (!append("    <credits>\n      <director>%s %s</director>\n",
+                            firstnames[random(textrnd) % 8],lastnames[random(textrnd) % 8])) return NULL;
+                for (int i=0; i<options->credits; i++)
+                {
+                    if (!append("      <actor>%s %s</actor>\n",firstnames[random(textrnd) % 8],
+                                lastnames[random(textrnd) % 8])) return NULL;
+                }
+                if (!append("    </credits>\n")) return NULL;
+            }
+            if (!append("    <date>%i</date>\n    <category lang=\"de\">%s</category>\n"
+                        "    <country>D</country>\n",p.year,Category(p.category))) return NULL;
+            if (p.season)
+            {
+                if (!append("    <episode-num system=\"xmltv_ns\">%i.%i.</episode-num>\n",
+                            p.season-1,p.episode-1)) return NULL;
+            }
+            if (!append("    <video>\n      <aspect>16:9</aspect>\n    </video>\n"
+                        "    <audio>\n      <stereo>stereo</stereo>\n    </audio>\n"
+                        "    <rating system=\"FSK\">\n      <value>%i</value>\n    </rating>\n"
+                        "    <star-rating>\n      <value>%i/5</value>\n    </star-rating>\n"
+                        "  </programme>\n",(int) (random(textrnd) % 4)*6,(int) (1+random(textrnd) % 5))) return NULL;
+        }
+    }
+    if (!append("</tv>\n")) return NULL;
+
+    char *doc=buf;
+    if (Len) *Len=len;
+    buf=NULL;
+    len=allocated=0;
+    return doc;
+}
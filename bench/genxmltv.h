@@ -0,0 +1,64 @@
+/*
+ * genxmltv.h: Synthetic XMLTV generator for the xmltv2vdr benchmark
+ *
+ */
+
+#ifndef _GENXMLTV_H
+#define _GENXMLTV_H
+
+#include <stddef.h>
+#include <time.h>
+
+struct tGenOptions
+{
+    int channels;
+    int days;
+    int descsize;  // bytes per description
+    int credits;   // actors per programme
+    unsigned int seed;
+    time_t start;
+};
+
+struct tGenProgramme
+{
+    int channel;
+    int index;
+    time_t start;
+    int duration;
+    char title[64];
+    char shorttext[64];
+    int season;
+    int episode;
+    int year;
+    int category;
+};
+
+class cGenXMLTV
+{
+private:
+    const tGenOptions *options;
+    unsigned int rnd;     // programmes
+    unsigned int textrnd; // descriptions and credits
+    int channel;
+    int index;
+    time_t next;
+    time_t end;
+    char *buf;
+    size_t len;
+    size_t allocated;
+    static unsigned int random(unsigned int &State);
+    static const char *word(unsigned int &State);
+    bool append(const char *Format, ...) __attribute__ ((format (printf, 2, 3)));
+    bool appendtext(int Size);
+public:
+    cGenXMLTV(const tGenOptions *Options);
+    ~cGenXMLTV();
+    static void ChannelName(int Channel, char *Name, size_t Size);
+    static void ChannelID(int Channel, char *ID, size_t Size);
+    void Reset(int Channel);
+    bool Next(tGenProgramme *Programme);
+    char *XMLTV(size_t *Len); // caller frees the document
+    static const char *Category(int Category);
+};
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * glue.cpp: Plugin glue for the xmltv2vdr benchmark
+ *
+ * Replaces the parts of xmltv2vdr.cpp which are needed by the other
+ * plugin sources, without the plugin, menu and epg handler classes.
+ *
+ */
+
+#include <stdarg.h>
+
+#include "../xmltv2vdr.h"
+#include "../debug.h"
+
+char *logfile=NULL;
+
+int ioprio_set(int UNUSED(which), int UNUSED(who), int UNUSED(ioprio))
+{
+    return 0;
+}
+
+void logger(cEPGSource *source, char logtype, const char* format, ...)
+{
+    va_list ap;
+    char *ptr;
+    va_start(ap,format);
+    if (vasprintf(&ptr,format,ap)==-1) ptr=NULL;
+    va_end(ap);
+    if (!ptr) return;
+
+    char *crlf=strchr(ptr,'\n');
+    if (crlf) *crlf=0;
+
+    if (source && logtype!='T')
+    {
+        time_t now=time(NULL);
+        struct tm tm;
+        localtime_r(&now,&tm);
+        source->Add2Log(&tm,logtype,ptr);
+    }
+
+    switch (logtype)
+    {
+    case 'E':
+        if (SysLogLevel>0) syslog_with_tid(LOG_ERR,"ERROR %s",ptr);
+        break;
+    case 'I':
+        if (SysLogLevel>1) syslog_with_tid(LOG_ERR,"%s",ptr);
+        break;
+    case 'D':
+    case 'T':
+        if (SysLogLevel>2) syslog_with_tid(LOG_ERR,"%s",ptr);
+        break;
+    default:
+        break;
+    }
+    free(ptr);
+}
+
+cEPGSearch_Client::cEPGSearch_Client()
+{
+    plugin=NULL;
+}
+
+bool cEPGSearch_Client::EnableSearchTimer()
+{
+    return false;
+}
+
+bool cEPGSearch_Client::DisableSearchTimer()
+{
+    return false;
+}
+
+// -------------------------------------------------------------
+
+cGlobals::cGlobals()
+{
+    confdir=NULL;
+    epgfile=NULL;
+    epdir=NULL;
+    epcodeset=NULL;
+    imgdir=NULL;
+    codeset=NULL;
+    srcorder=NULL;
+    wakeup=false;
+    epghandler=NULL;
+    epgtimer=NULL;
+    epgseasonepisode=NULL;
+    piclinker=NULL;
+    epall=0;
+    order=strdup(GetDefaultOrder());
+    imgdelafter=30;
+    importthreads=1;
+    soundex=false;
+    dbgeneration=0;
+
+    // fixed codeset, the results must not depend on the locale
+    codeset=strdup("UTF-8");
+}
+
+cGlobals::~cGlobals()
+{
+    free(confdir);
+    free(epgfile);
+    free(epdir);
+    free(imgdir);
+    free(codeset);
+    free(order);
+    free(srcorder);
+    epgsources.Remove();
+    epgmappings.Remove();
+    textmappings.Remove();
+}
+
+char *cGlobals::GetDefaultOrder()
+{
+    return (char *) "LOT,CRS,CAD,ORT,CAT,VID,AUD,SEE,RAT,STR,REV";
+}
+
+void cGlobals::SetImgDir(const char* ImgDir)
+{
+    free(imgdir);
+    imgdir=ImgDir ? strdup(ImgDir) : NULL;
+}
+
+void cGlobals::SetEPDir(const char* EPDir)
+{
+    free(epdir);
+    epdir=EPDir ? strdup(EPDir) : NULL;
+    epcodeset=codeset;
+}
+
+bool cGlobals::DBExists()
+{
+    if (!epgfile) return true;
+    struct stat statbuf;
+    if (stat(epgfile,&statbuf)==-1) return false;
+    if (!statbuf.st_size) return false;
+    return true;
+}
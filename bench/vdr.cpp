@@ -0,0 +1,1095 @@
+/*
+ * vdr.cpp: Minimal VDR stubs for the xmltv2vdr benchmark
+ *
+ * The list, thread and epg classes follow the VDR implementation,
+ * everything else is reduced to what the plugin sources need.
+ *
+ */
+
+#include <map>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "vdr/channels.h"
+#include "vdr/epg.h"
+#include "vdr/thread.h"
+#include "vdr/timers.h"
+#include "vdr/tools.h"
+
+int SysLogLevel=1;
+
+void syslog_with_tid(int priority, const char *format, ...)
+{
+    va_list ap;
+    char fmt[255];
+    snprintf(fmt,sizeof(fmt),"[%d] %s\n",cThread::ThreadId(),format);
+    va_start(ap,format);
+    vfprintf(stderr,fmt,ap);
+    va_end(ap);
+}
+
+// --- string functions ------------------------------------------------------------------------------------
+
+char *strcpyrealloc(char *dest, const char *src)
+{
+    if (src)
+    {
+        int l=max(dest ? strlen(dest) : 0,strlen(src))+1;
+        dest=(char *) realloc(dest,l);
+        if (dest) strcpy(dest,src);
+    }
+    else
+    {
+        free(dest);
+        dest=NULL;
+    }
+    return dest;
+}
+
+char *strn0cpy(char *dest, const char *src, size_t n)
+{
+    char *s=dest;
+    for ( ; --n && (*dest=*src)!=0; dest++, src++) ;
+    *dest=0;
+    return s;
+}
+
+char *strreplace(char *s, char c1, char c2)
+{
+    if (s)
+    {
+        char *p=s;
+        while (*p)
+        {
+            if (*p==c1) *p=c2;
+            p++;
+        }
+    }
+    return s;
+}
+
+char *strreplace(char *s, const char *s1, const char *s2)
+{
+    char *p=strstr(s,s1);
+    if (p)
+    {
+        int of=p-s;
+        int l=strlen(s);
+        int l1=strlen(s1);
+        int l2=strlen(s2);
+        if (l2>l1)
+        {
+            char *t=(char *) realloc(s,l-l1+l2+1);
+            if (!t) return s;
+            s=t;
+        }
+        char *sof=s+of;
+        if (l2!=l1) memmove(sof+l2,sof+l1,l-of-l1+1);
+        strncpy(sof,s2,l2);
+    }
+    return s;
+}
+
+char *strcatrealloc(char *dest, const char *src)
+{
+    if (src && *src)
+    {
+        size_t l=(dest ? strlen(dest) : 0)+strlen(src)+1;
+        char *new_dest=(char *) realloc(dest,l);
+        if (!new_dest) return dest;
+        if (!dest) *new_dest=0;
+        strcat(new_dest,src);
+        return new_dest;
+    }
+    return dest;
+}
+
+char *strncatrealloc(char *dest, const char *src, size_t len)
+{
+    if (src && *src && len)
+    {
+        size_t l=(dest ? strlen(dest) : 0)+min(strlen(src),len)+1;
+        char *new_dest=(char *) realloc(dest,l);
+        if (!new_dest) return dest;
+        if (!dest) *new_dest=0;
+        strncat(new_dest,src,len);
+        return new_dest;
+    }
+    return dest;
+}
+
+char *skipspace(const char *s)
+{
+    if ((uchar) *s>' ') return (char *) s;
+    while (*s && (uchar) *s<=' ') s++;
+    return (char *) s;
+}
+
+char *compactspace(char *s)
+{
+    if (s && *s)
+    {
+        char *t=skipspace(s);
+        char *p=t;
+        while (p && *p)
+        {
+            char *q=skipspace(p);
+            if (q-p>1) memmove(p+1,q,strlen(q)+1);
+            p++;
+        }
+        if (t!=s) memmove(s,t,strlen(t)+1);
+        int l=strlen(s);
+        while (l && (uchar) s[l-1]<=' ') s[--l]=0;
+    }
+    return s;
+}
+
+bool isempty(const char *s)
+{
+    return !(s && *skipspace(s));
+}
+
+// --- cString ---------------------------------------------------------------------------------------------
+
+cString::cString(const char *S, bool TakePointer)
+{
+    s=TakePointer ? (char *) S : S ? strdup(S) : NULL;
+}
+
+cString::cString(const cString &String)
+{
+    s=String.s ? strdup(String.s) : NULL;
+}
+
+cString::~cString()
+{
+    free(s);
+}
+
+cString &cString::operator=(const cString &String)
+{
+    if (this==&String) return *this;
+    free(s);
+    s=String.s ? strdup(String.s) : NULL;
+    return *this;
+}
+
+cString &cString::operator=(const char *String)
+{
+    if (s==String) return *this;
+    free(s);
+    s=String ? strdup(String) : NULL;
+    return *this;
+}
+
+cString cString::sprintf(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap,fmt);
+    char *buffer;
+    if (!fmt || vasprintf(&buffer,fmt,ap)<0) buffer=strdup("???");
+    va_end(ap);
+    return cString(buffer,true);
+}
+
+// --- cCharSetConv ----------------------------------------------------------------------------------------
+
+cCharSetConv::cCharSetConv(const char *FromCode, const char *ToCode)
+{
+    if (!FromCode) FromCode=SystemCharacterTable();
+    if (!ToCode) ToCode="UTF-8";
+    cd=iconv_open(ToCode,FromCode);
+    result=NULL;
+    length=0;
+}
+
+cCharSetConv::~cCharSetConv()
+{
+    free(result);
+    if (cd!=(iconv_t) -1) iconv_close(cd);
+}
+
+const char *cCharSetConv::Convert(const char *From, char *To, size_t ToLength)
+{
+    if (cd!=(iconv_t) -1 && From && *From)
+    {
+        char *FromPtr=(char *) From;
+        size_t FromLength=strlen(From);
+        char *ToPtr=To;
+        if (!ToPtr)
+        {
+            int NewLength=max(length,FromLength*2);
+            if (char *NewBuffer=(char *) realloc(result,NewLength))
+            {
+                length=NewLength;
+                result=NewBuffer;
+            }
+            else
+            {
+                esyslog("ERROR: out of memory");
+                return From;
+            }
+            ToPtr=result;
+            ToLength=length;
+        }
+        else if (!ToLength)
+            return From;
+        char *Converted=ToPtr;
+        while (FromLength>0)
+        {
+            if (iconv(cd,&FromPtr,&FromLength,&ToPtr,&ToLength)==size_t(-1))
+            {
+                if (errno==E2BIG || ((errno==EILSEQ) && (ToLength<1)))
+                {
+                    if (To) break; // caller provided a fixed size buffer
+                    int d=ToPtr-result;
+                    int r=length/2;
+                    int NewLength=length+r;
+                    if (char *NewBuffer=(char *) realloc(result,NewLength))
+                    {
+                        length=NewLength;
+                        Converted=result=NewBuffer;
+                    }
+                    else
+                    {
+                        esyslog("ERROR: out of memory");
+                        return From;
+                    }
+                    ToLength+=r;
+                    ToPtr=result+d;
+                }
+                if (errno==EILSEQ)
+                {
+                    // A character can't be converted, so mark it with '?' and proceed:
+                    FromPtr++;
+                    FromLength--;
+                    *ToPtr++='?';
+                    ToLength--;
+                }
+                else if (errno!=E2BIG)
+                    return From; // unknown error, return original string
+            }
+        }
+        *ToPtr=0;
+        return Converted;
+    }
+    return From;
+}
+
+// --- cListObject -----------------------------------------------------------------------------------------
+
+cListObject::cListObject(void)
+{
+    prev=next=NULL;
+}
+
+cListObject::~cListObject()
+{
+}
+
+void cListObject::Append(cListObject *Object)
+{
+    next=Object;
+    Object->prev=this;
+}
+
+void cListObject::Insert(cListObject *Object)
+{
+    prev=Object;
+    Object->next=this;
+}
+
+void cListObject::Unlink(void)
+{
+    if (next) next->prev=prev;
+    if (prev) prev->next=next;
+    next=prev=NULL;
+}
+
+int cListObject::Index(void) const
+{
+    cListObject *p=prev;
+    int i=0;
+    while (p)
+    {
+        i++;
+        p=p->prev;
+    }
+    return i;
+}
+
+// --- cListBase -------------------------------------------------------------------------------------------
+
+cListBase::cListBase(void)
+{
+    objects=lastObject=NULL;
+    count=0;
+}
+
+cListBase::~cListBase()
+{
+    Clear();
+}
+
+void cListBase::Add(cListObject *Object, cListObject *After)
+{
+    if (After && After!=lastObject)
+    {
+        After->Next()->Insert(Object);
+        After->Append(Object);
+    }
+    else
+    {
+        if (lastObject)
+            lastObject->Append(Object);
+        else
+            objects=Object;
+        lastObject=Object;
+    }
+    count++;
+}
+
+void cListBase::Ins(cListObject *Object, cListObject *Before)
+{
+    if (Before && Before!=objects)
+    {
+        Before->Prev()->Append(Object);
+        Before->Insert(Object);
+    }
+    else
+    {
+        if (objects)
+            objects->Insert(Object);
+        else
+            lastObject=Object;
+        objects=Object;
+    }
+    count++;
+}
+
+void cListBase::Del(cListObject *Object, bool DeleteObject)
+{
+    if (Object==objects) objects=Object->Next();
+    if (Object==lastObject) lastObject=Object->Prev();
+    Object->Unlink();
+    if (DeleteObject) delete Object;
+    count--;
+}
+
+void cListBase::Move(int From, int To)
+{
+    Move(Get(From),Get(To));
+}
+
+void cListBase::Move(cListObject *From, cListObject *To)
+{
+    if (From && To && From!=To)
+    {
+        if (From->Index()<To->Index()) To=To->Next();
+        if (From==objects) objects=From->Next();
+        if (From==lastObject) lastObject=From->Prev();
+        From->Unlink();
+        if (To)
+        {
+            if (To->Prev()) To->Prev()->Append(From);
+            From->Append(To);
+        }
+        else
+        {
+            lastObject->Append(From);
+            lastObject=From;
+        }
+        if (!From->Prev()) objects=From;
+    }
+}
+
+void cListBase::Clear(void)
+{
+    while (objects)
+    {
+        cListObject *object=objects->Next();
+        delete objects;
+        objects=object;
+    }
+    objects=lastObject=NULL;
+    count=0;
+}
+
+cListObject *cListBase::Get(int Index) const
+{
+    if (Index<0) return NULL;
+    cListObject *object=objects;
+    while (object && Index-->0) object=object->Next();
+    return object;
+}
+
+static int CompareListObjects(const void *a, const void *b)
+{
+    const cListObject *la=*(const cListObject **) a;
+    const cListObject *lb=*(const cListObject **) b;
+    return la->Compare(*lb);
+}
+
+void cListBase::Sort(void)
+{
+    int n=Count();
+    if (!n) return;
+    cListObject **a=(cListObject **) malloc(n*sizeof(cListObject *));
+    if (!a) return;
+    cListObject *object=objects;
+    int i=0;
+    while (object && i<n)
+    {
+        a[i++]=object;
+        object=object->Next();
+    }
+    qsort(a,n,sizeof(cListObject *),CompareListObjects);
+    objects=lastObject=NULL;
+    for (i=0; i<n; i++)
+    {
+        a[i]->Unlink();
+        count--;
+        Add(a[i]);
+    }
+    free(a);
+}
+
+// --- cStringList -----------------------------------------------------------------------------------------
+
+cStringList::~cStringList()
+{
+    Clear();
+}
+
+int cStringList::Find(const char *s) const
+{
+    for (int i=0; i<Size(); i++)
+    {
+        if (!strcmp(s,At(i))) return i;
+    }
+    return -1;
+}
+
+void cStringList::Clear(void)
+{
+    for (int i=0; i<Size(); i++) free(At(i));
+    cVector<char *>::Clear();
+}
+
+// --- cCondWait -------------------------------------------------------------------------------------------
+
+static bool GetAbsTime(struct timespec *Abstime, int MillisecondsFromNow)
+{
+    struct timeval now;
+    if (gettimeofday(&now,NULL)==0)
+    {
+        now.tv_sec+=MillisecondsFromNow/1000;
+        now.tv_usec+=(MillisecondsFromNow % 1000)*1000;
+        if (now.tv_usec>=1000000)
+        {
+            now.tv_sec++;
+            now.tv_usec-=1000000;
+        }
+        Abstime->tv_sec=now.tv_sec;
+        Abstime->tv_nsec=now.tv_usec*1000;
+        return true;
+    }
+    return false;
+}
+
+cCondWait::cCondWait(void)
+{
+    signaled=false;
+    pthread_mutex_init(&mutex,NULL);
+    pthread_cond_init(&cond,NULL);
+}
+
+cCondWait::~cCondWait()
+{
+    pthread_cond_broadcast(&cond);
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+void cCondWait::SleepMs(int TimeoutMs)
+{
+    cCondWait w;
+    w.Wait(max(TimeoutMs,3));
+}
+
+bool cCondWait::Wait(int TimeoutMs)
+{
+    pthread_mutex_lock(&mutex);
+    if (!signaled)
+    {
+        if (TimeoutMs)
+        {
+            struct timespec abstime;
+            if (GetAbsTime(&abstime,TimeoutMs))
+            {
+                while (!signaled)
+                {
+                    if (pthread_cond_timedwait(&cond,&mutex,&abstime)==ETIMEDOUT) break;
+                }
+            }
+        }
+        else
+        {
+            pthread_cond_wait(&cond,&mutex);
+        }
+    }
+    bool r=signaled;
+    signaled=false;
+    pthread_mutex_unlock(&mutex);
+    return r;
+}
+
+void cCondWait::Signal(void)
+{
+    pthread_mutex_lock(&mutex);
+    signaled=true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+// --- cCondVar --------------------------------------------------------------------------------------------
+
+cCondVar::cCondVar(void)
+{
+    pthread_cond_init(&cond,NULL);
+}
+
+cCondVar::~cCondVar()
+{
+    pthread_cond_broadcast(&cond);
+    pthread_cond_destroy(&cond);
+}
+
+void cCondVar::Wait(cMutex &Mutex)
+{
+    if (Mutex.locked)
+    {
+        int locked=Mutex.locked;
+        Mutex.locked=0;
+        pthread_cond_wait(&cond,&Mutex.mutex);
+        Mutex.locked=locked;
+    }
+}
+
+bool cCondVar::TimedWait(cMutex &Mutex, int TimeoutMs)
+{
+    bool r=true;
+    if (Mutex.locked)
+    {
+        struct timespec abstime;
+        if (GetAbsTime(&abstime,TimeoutMs))
+        {
+            int locked=Mutex.locked;
+            Mutex.locked=0;
+            if (pthread_cond_timedwait(&cond,&Mutex.mutex,&abstime)==ETIMEDOUT) r=false;
+            Mutex.locked=locked;
+        }
+    }
+    return r;
+}
+
+void cCondVar::Broadcast(void)
+{
+    pthread_cond_broadcast(&cond);
+}
+
+// --- cMutex ----------------------------------------------------------------------------------------------
+
+cMutex::cMutex(void)
+{
+    locked=0;
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr,PTHREAD_MUTEX_ERRORCHECK_NP);
+    pthread_mutex_init(&mutex,&attr);
+}
+
+cMutex::~cMutex()
+{
+    pthread_mutex_destroy(&mutex);
+}
+
+void cMutex::Lock(void)
+{
+    pthread_mutex_lock(&mutex);
+    locked++;
+}
+
+void cMutex::Unlock(void)
+{
+    if (!--locked) pthread_mutex_unlock(&mutex);
+}
+
+// --- cMutexLock ------------------------------------------------------------------------------------------
+
+cMutexLock::cMutexLock(cMutex *Mutex)
+{
+    mutex=NULL;
+    locked=false;
+    Lock(Mutex);
+}
+
+cMutexLock::~cMutexLock()
+{
+    if (mutex && locked) mutex->Unlock();
+}
+
+bool cMutexLock::Lock(cMutex *Mutex)
+{
+    if (Mutex && !mutex)
+    {
+        mutex=Mutex;
+        Mutex->Lock();
+        locked=true;
+        return true;
+    }
+    return false;
+}
+
+// --- cThread ---------------------------------------------------------------------------------------------
+
+cThread::cThread(const char *Description, bool LowPriority)
+{
+    active=running=false;
+    childTid=0;
+    description=Description ? strdup(Description) : NULL;
+}
+
+cThread::~cThread()
+{
+    Cancel(); // just in case the derived class didn't call it
+    free(description);
+}
+
+void cThread::SetPriority(int Priority)
+{
+    if (setpriority(PRIO_PROCESS,0,Priority)<0) LOG_ERROR;
+}
+
+void cThread::SetDescription(const char *Description, ...)
+{
+    free(description);
+    description=NULL;
+    if (Description)
+    {
+        va_list ap;
+        va_start(ap,Description);
+        if (vasprintf(&description,Description,ap)==-1) description=NULL;
+        va_end(ap);
+    }
+}
+
+void *cThread::StartThread(cThread *Thread)
+{
+    Thread->Action();
+    Thread->running=false;
+    Thread->active=false;
+    return NULL;
+}
+
+bool cThread::Start(void)
+{
+    if (!running)
+    {
+        if (active) return true; // thread is still winding down
+        running=active=true;
+        if (pthread_create(&childTid,NULL,(void *(*)(void *)) &StartThread,(void *) this)==0)
+        {
+            pthread_detach(childTid);
+        }
+        else
+        {
+            LOG_ERROR;
+            active=running=false;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool cThread::Active(void)
+{
+    return active;
+}
+
+void cThread::Cancel(int WaitSeconds)
+{
+    running=false;
+    if (active && WaitSeconds>-1)
+    {
+        if (WaitSeconds>0)
+        {
+            for (time_t t0=time(NULL)+WaitSeconds; time(NULL)<t0; )
+            {
+                if (!Active()) return;
+                cCondWait::SleepMs(10);
+            }
+            esyslog("ERROR: %s thread %lu won't end (waited %d seconds) - canceling it...",
+                    description ? description : "",(unsigned long) childTid,WaitSeconds);
+        }
+        pthread_cancel(childTid);
+        childTid=0;
+        active=false;
+    }
+}
+
+tThreadId cThread::ThreadId(void)
+{
+    return syscall(__NR_gettid);
+}
+
+// --- tChannelID ------------------------------------------------------------------------------------------
+
+const tChannelID tChannelID::InvalidID;
+
+// sources are coded like in VDR: type in the upper byte, for satellites
+// the orbital position in 1/10 degrees and bit 11 for east
+#define SOURCE_TYPE(s) ((s)>>24)
+#define SOURCE_EAST 0x0800
+
+static int SourceFromString(const char *s)
+{
+    if (!s || !*s) return 0;
+    int code=(uchar) *s<<24;
+    if (*s=='S')
+    {
+        int pos=0;
+        bool dot=false;
+        const char *p=s+1;
+        while (*p)
+        {
+            if (*p>='0' && *p<='9') pos=pos*10+(*p-'0');
+            else if (*p=='.') dot=true;
+            else if (*p=='E') code|=SOURCE_EAST;
+            else if (*p!='W') return 0;
+            p++;
+        }
+        if (!dot) pos*=10;
+        code|=pos & 0x7ff;
+    }
+    return code;
+}
+
+static cString SourceToString(int Code)
+{
+    char type=(char) SOURCE_TYPE(Code);
+    if (type!='S') return cString::sprintf("%c",type);
+    int pos=Code & 0x7ff;
+    return cString::sprintf("S%d.%d%c",pos/10,pos%10,(Code & SOURCE_EAST) ? 'E' : 'W');
+}
+
+tChannelID tChannelID::FromString(const char *s)
+{
+    char *sourcebuf=NULL;
+    int nid,tid,sid,rid=0;
+    int fields=sscanf(s,"%m[^-]-%d-%d-%d-%d",&sourcebuf,&nid,&tid,&sid,&rid);
+    if (fields==4 || fields==5)
+    {
+        int source=SourceFromString(sourcebuf);
+        free(sourcebuf);
+        if (source) return tChannelID(source,nid,tid,sid,rid);
+        return tChannelID::InvalidID;
+    }
+    free(sourcebuf);
+    return tChannelID::InvalidID;
+}
+
+cString tChannelID::ToString(void) const
+{
+    char buffer[256];
+    snprintf(buffer,sizeof(buffer),rid ? "%s-%d-%d-%d-%d" : "%s-%d-%d-%d",
+             *SourceToString(source),nid,tid,sid,rid);
+    return buffer;
+}
+
+// --- cChannel --------------------------------------------------------------------------------------------
+
+cChannels Channels;
+
+cChannel::cChannel(int Number, const char *Name, tChannelID ChannelID)
+{
+    number=Number;
+    name=strdup(Name ? Name : "");
+    channelid=ChannelID;
+}
+
+cChannel::~cChannel()
+{
+    free(name);
+}
+
+cChannel *cChannels::GetByNumber(int Number, int SkipGap)
+{
+    for (cChannel *channel=First(); channel; channel=Next(channel))
+    {
+        if (channel->Number()==Number) return channel;
+    }
+    return NULL;
+}
+
+cChannel *cChannels::GetByChannelID(tChannelID ChannelID, bool TryWithoutRid, bool TryWithoutPolarization)
+{
+    for (cChannel *channel=First(); channel; channel=Next(channel))
+    {
+        if (channel->GetChannelID()==ChannelID) return channel;
+    }
+    if (TryWithoutRid)
+    {
+        ChannelID.ClrRid();
+        for (cChannel *channel=First(); channel; channel=Next(channel))
+        {
+            if (channel->GetChannelID().ClrRid()==ChannelID) return channel;
+        }
+    }
+    return NULL;
+}
+
+// --- cEvent ----------------------------------------------------------------------------------------------
+
+cEvent::cEvent(tEventID EventID)
+{
+    schedule=NULL;
+    eventID=EventID;
+    tableID=0xFF;
+    version=0xFF;
+    memset(contents,0,sizeof(contents));
+    parentalRating=0;
+    title=shortText=description=NULL;
+    startTime=0;
+    duration=0;
+}
+
+cEvent::~cEvent()
+{
+    free(title);
+    free(shortText);
+    free(description);
+}
+
+int cEvent::Compare(const cListObject &ListObject) const
+{
+    cEvent *e=(cEvent *) &ListObject;
+    return startTime-e->startTime;
+}
+
+tChannelID cEvent::ChannelID(void) const
+{
+    return schedule ? schedule->ChannelID() : tChannelID();
+}
+
+void cEvent::SetEventID(tEventID EventID)
+{
+    if (eventID!=EventID)
+    {
+        if (schedule) schedule->UnhashEvent(this);
+        eventID=EventID;
+        if (schedule) schedule->HashEvent(this);
+    }
+}
+
+void cEvent::SetTitle(const char *Title)
+{
+    title=strcpyrealloc(title,Title);
+}
+
+void cEvent::SetShortText(const char *ShortText)
+{
+    shortText=strcpyrealloc(shortText,ShortText);
+}
+
+void cEvent::SetDescription(const char *Description)
+{
+    description=strcpyrealloc(description,Description);
+}
+
+void cEvent::SetContents(uchar *Contents)
+{
+    for (int i=0; i<MaxEventContents; i++) contents[i]=Contents[i];
+}
+
+void cEvent::SetStartTime(time_t StartTime)
+{
+    if (startTime!=StartTime)
+    {
+        if (schedule) schedule->UnhashEvent(this);
+        startTime=StartTime;
+        if (schedule) schedule->HashEvent(this);
+    }
+}
+
+// --- cSchedule -------------------------------------------------------------------------------------------
+
+struct tEventHash
+{
+    std::map<tEventID,cEvent *> ids;
+    std::map<time_t,cEvent *> starts;
+};
+
+cSchedule::cSchedule(tChannelID ChannelID)
+{
+    channelID=ChannelID;
+    hash=new tEventHash;
+}
+
+cSchedule::~cSchedule()
+{
+    delete hash;
+}
+
+void cSchedule::HashEvent(cEvent *Event)
+{
+    hash->ids[Event->EventID()]=Event;
+    if (Event->StartTime()>0) hash->starts[Event->StartTime()]=Event;
+}
+
+void cSchedule::UnhashEvent(cEvent *Event)
+{
+    std::map<tEventID,cEvent *>::iterator id=hash->ids.find(Event->EventID());
+    if (id!=hash->ids.end() && id->second==Event) hash->ids.erase(id);
+    std::map<time_t,cEvent *>::iterator st=hash->starts.find(Event->StartTime());
+    if (st!=hash->starts.end() && st->second==Event) hash->starts.erase(st);
+}
+
+void cSchedule::Sort(void)
+{
+    events.Sort();
+}
+
+cEvent *cSchedule::AddEvent(cEvent *Event)
+{
+    events.Add(Event);
+    Event->schedule=this;
+    HashEvent(Event);
+    return Event;
+}
+
+void cSchedule::DelEvent(cEvent *Event)
+{
+    if (Event->schedule==this)
+    {
+        UnhashEvent(Event);
+        events.Del(Event);
+    }
+}
+
+const cEvent *cSchedule::GetEvent(tEventID EventID, time_t StartTime) const
+{
+    if (StartTime>0)
+    {
+        std::map<time_t,cEvent *>::const_iterator st=hash->starts.find(StartTime);
+        return (st!=hash->starts.end()) ? st->second : NULL;
+    }
+    std::map<tEventID,cEvent *>::const_iterator id=hash->ids.find(EventID);
+    return (id!=hash->ids.end()) ? id->second : NULL;
+}
+
+// --- cSchedules ------------------------------------------------------------------------------------------
+
+static cMutex SchedulesMutex;
+
+cSchedules cSchedules::schedules;
+time_t cSchedules::modified=0;
+
+cSchedulesLock::cSchedulesLock(bool WriteLock, int TimeoutMs)
+{
+    SchedulesMutex.Lock();
+    locked=true;
+}
+
+cSchedulesLock::~cSchedulesLock()
+{
+    if (locked) SchedulesMutex.Unlock();
+}
+
+const cSchedules *cSchedules::Schedules(cSchedulesLock &SchedulesLock)
+{
+    return SchedulesLock.Locked() ? &schedules : NULL;
+}
+
+void cSchedules::SetModified(cSchedule *Schedule) const
+{
+    modified=time(NULL);
+}
+
+cSchedule *cSchedules::AddSchedule(tChannelID ChannelID)
+{
+    ChannelID.ClrRid();
+    cSchedule *p=(cSchedule *) GetSchedule(ChannelID);
+    if (!p)
+    {
+        p=new cSchedule(ChannelID);
+        Add(p);
+    }
+    return p;
+}
+
+const cSchedule *cSchedules::GetSchedule(tChannelID ChannelID) const
+{
+    ChannelID.ClrRid();
+    for (cSchedule *p=First(); p; p=Next(p))
+    {
+        if (p->ChannelID()==ChannelID) return p;
+    }
+    return NULL;
+}
+
+const cSchedule *cSchedules::GetSchedule(const cChannel *Channel, bool AddIfMissing) const
+{
+    const cSchedule *p=GetSchedule(Channel->GetChannelID());
+    if (!p && AddIfMissing) p=((cSchedules *) this)->AddSchedule(Channel->GetChannelID());
+    return p;
+}
+
+// --- cTimer ----------------------------------------------------------------------------------------------
+
+cTimers Timers;
+
+int cTimer::TimeToInt(int t)
+{
+    return (t/100*60+t%100)*60;
+}
+
+time_t cTimer::SetTime(time_t t, int SecondsFromMidnight)
+{
+    struct tm tm_r;
+    tm tm=*localtime_r(&t,&tm_r);
+    tm.tm_hour=SecondsFromMidnight/3600;
+    tm.tm_min=(SecondsFromMidnight%3600)/60;
+    tm.tm_sec=SecondsFromMidnight%60;
+    tm.tm_isdst=-1; // makes sure mktime() will determine the correct DST setting
+    return mktime(&tm);
+}
+
+time_t cTimer::IncDay(time_t t, int Days)
+{
+    struct tm tm_r;
+    tm tm=*localtime_r(&t,&tm_r);
+    tm.tm_mday+=Days; // now tm_mday may be out of its valid range
+    int h=tm.tm_hour; // save original hour to compensate for DST change
+    tm.tm_isdst=-1;   // makes sure mktime() will determine the correct DST setting
+    t=mktime(&tm);    // normalizes the tm structure
+    tm.tm_hour=h;     // compensates for DST change
+    return mktime(&tm);
+}
+
+int cTimer::GetWDay(time_t t)
+{
+    struct tm tm_r;
+    int weekday=localtime_r(&t,&tm_r)->tm_wday;
+    return weekday==0 ? 6 : weekday-1; // we start with Monday==0!
+}
+
+cString cTimer::PrintDay(time_t Day, int WeekDays, bool SingleByteChars)
+{
+    char buffer[32];
+    struct tm tm_r;
+    localtime_r(&Day,&tm_r);
+    strftime(buffer,sizeof(buffer),"%Y-%m-%d",&tm_r);
+    return buffer;
+}
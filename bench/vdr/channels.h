@@ -0,0 +1,124 @@
+/*
+ * channels.h: Minimal VDR stubs for the xmltv2vdr benchmark
+ *
+ */
+
+#ifndef __CHANNELS_H
+#define __CHANNELS_H
+
+#include "thread.h"
+#include "tools.h"
+
+struct tChannelID
+{
+private:
+    int source;
+    int nid;
+    int tid;
+    int sid;
+    int rid;
+public:
+    tChannelID(void)
+    {
+        source = nid = tid = sid = rid = 0;
+    }
+    tChannelID(int Source, int Nid, int Tid, int Sid, int Rid = 0)
+    {
+        source = Source;
+        nid = Nid;
+        tid = Tid;
+        sid = Sid;
+        rid = Rid;
+    }
+    bool operator== (const tChannelID &arg) const
+    {
+        return source == arg.source && nid == arg.nid && tid == arg.tid && sid == arg.sid && rid == arg.rid;
+    }
+    bool Valid(void) const
+    {
+        return (nid || tid) && sid;
+    }
+    tChannelID &ClrRid(void)
+    {
+        rid = 0;
+        return *this;
+    }
+    int Source(void) const
+    {
+        return source;
+    }
+    int Nid(void) const
+    {
+        return nid;
+    }
+    int Tid(void) const
+    {
+        return tid;
+    }
+    int Sid(void) const
+    {
+        return sid;
+    }
+    int Rid(void) const
+    {
+        return rid;
+    }
+    static tChannelID FromString(const char *s);
+    cString ToString(void) const;
+    static const tChannelID InvalidID;
+};
+
+class cChannel : public cListObject
+{
+private:
+    char *name;
+    int number;
+    tChannelID channelid;
+public:
+    cChannel(int Number, const char *Name, tChannelID ChannelID);
+    virtual ~cChannel();
+    const char *Name(void) const
+    {
+        return name;
+    }
+    const char *ShortName(bool OrName = false) const
+    {
+        return name;
+    }
+    int Number(void) const
+    {
+        return number;
+    }
+    bool GroupSep(void) const
+    {
+        return false;
+    }
+    tChannelID GetChannelID(void) const
+    {
+        return channelid;
+    }
+};
+
+class cChannels : public cList<cChannel>
+{
+public:
+    bool Lock(bool Write, int TimeoutMs = 0)
+    {
+        return true;
+    }
+    void Unlock(void) {}
+    cChannel *GetByNumber(int Number, int SkipGap = 0);
+    cChannel *GetByChannelID(tChannelID ChannelID, bool TryWithoutRid = false, bool TryWithoutPolarization = false);
+    int MaxNumber(void)
+    {
+        return Count();
+    }
+    int Modified(bool ByUser = false)
+    {
+        return 0;
+    }
+};
+
+extern cChannels Channels;
+
+#endif //__CHANNELS_H
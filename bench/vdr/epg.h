@@ -0,0 +1,205 @@
+/*
+ * epg.h: Minimal VDR stubs for the xmltv2vdr benchmark
+ *
+ * Events are looked up through hashes like in VDR, so the import
+ * timings are comparable.
+ *
+ */
+
+#ifndef __EPG_H
+#define __EPG_H
+
+#include <time.h>
+#include "channels.h"
+#include "thread.h"
+#include "tools.h"
+
+#define MAXEPGBUGFIXLEVEL 3
+#define MaxEventContents 4
+
+typedef u_int32_t tEventID;
+
+class cSchedule;
+
+class cEvent : public cListObject
+{
+    friend class cSchedule;
+private:
+    cSchedule *schedule;
+    tEventID eventID;
+    uchar tableID;
+    uchar version;
+    uchar contents[MaxEventContents];
+    int parentalRating;
+    char *title;
+    char *shortText;
+    char *description;
+    time_t startTime;
+    int duration;
+public:
+    cEvent(tEventID EventID);
+    ~cEvent();
+    virtual int Compare(const cListObject &ListObject) const;
+    tChannelID ChannelID(void) const;
+    const cSchedule *Schedule(void) const
+    {
+        return schedule;
+    }
+    tEventID EventID(void) const
+    {
+        return eventID;
+    }
+    uchar TableID(void) const
+    {
+        return tableID;
+    }
+    uchar Version(void) const
+    {
+        return version;
+    }
+    const char *Title(void) const
+    {
+        return title;
+    }
+    const char *ShortText(void) const
+    {
+        return shortText;
+    }
+    const char *Description(void) const
+    {
+        return description;
+    }
+    uchar Contents(int i = 0) const
+    {
+        return (0 <= i && i < MaxEventContents) ? contents[i] : uchar(0);
+    }
+    int ParentalRating(void) const
+    {
+        return parentalRating;
+    }
+    time_t StartTime(void) const
+    {
+        return startTime;
+    }
+    time_t EndTime(void) const
+    {
+        return startTime + duration;
+    }
+    int Duration(void) const
+    {
+        return duration;
+    }
+    bool HasTimer(void) const
+    {
+        return false;
+    }
+    void SetEventID(tEventID EventID);
+    void SetTableID(uchar TableID)
+    {
+        tableID = TableID;
+    }
+    void SetVersion(uchar Version)
+    {
+        version = Version;
+    }
+    void SetTitle(const char *Title);
+    void SetShortText(const char *ShortText);
+    void SetDescription(const char *Description);
+    void SetContents(uchar *Contents);
+    void SetParentalRating(int ParentalRating)
+    {
+        parentalRating = ParentalRating;
+    }
+    void SetStartTime(time_t StartTime);
+    void SetDuration(int Duration)
+    {
+        duration = Duration;
+    }
+};
+
+struct tEventHash;
+
+class cSchedule : public cListObject
+{
+private:
+    tChannelID channelID;
+    cList<cEvent> events;
+    tEventHash *hash;
+public:
+    cSchedule(tChannelID ChannelID);
+    ~cSchedule();
+    tChannelID ChannelID(void) const
+    {
+        return channelID;
+    }
+    void HashEvent(cEvent *Event);
+    void UnhashEvent(cEvent *Event);
+    void Sort(void);
+    cEvent *AddEvent(cEvent *Event);
+    void DelEvent(cEvent *Event);
+    const cList<cEvent> *Events(void) const
+    {
+        return &events;
+    }
+    const cEvent *GetEvent(tEventID EventID, time_t StartTime = 0) const;
+};
+
+class cSchedulesLock
+{
+private:
+    bool locked;
+public:
+    cSchedulesLock(bool WriteLock = false, int TimeoutMs = 0);
+    ~cSchedulesLock();
+    bool Locked(void)
+    {
+        return locked;
+    }
+};
+
+class cSchedules : public cList<cSchedule>
+{
+    friend class cSchedulesLock;
+private:
+    static cSchedules schedules;
+    static time_t modified;
+public:
+    void SetModified(cSchedule *Schedule) const;
+    static time_t Modified(void)
+    {
+        return modified;
+    }
+    static const cSchedules *Schedules(cSchedulesLock &SchedulesLock);
+    cSchedule *AddSchedule(tChannelID ChannelID);
+    const cSchedule *GetSchedule(tChannelID ChannelID) const;
+    const cSchedule *GetSchedule(const cChannel *Channel, bool AddIfMissing = false) const;
+};
+
+class cEpgHandler : public cListObject
+{
+public:
+    cEpgHandler(void) {}
+    virtual ~cEpgHandler() {}
+    virtual bool IgnoreChannel(const cChannel *Channel)
+    {
+        return false;
+    }
+    virtual bool SetShortText(cEvent *Event, const char *ShortText)
+    {
+        return false;
+    }
+    virtual bool SetDescription(cEvent *Event, const char *Description)
+    {
+        return false;
+    }
+    virtual bool HandleEvent(cEvent *Event)
+    {
+        return false;
+    }
+    virtual bool SortSchedule(cSchedule *Schedule)
+    {
+        return false;
+    }
+};
+
+#endif //__EPG_H
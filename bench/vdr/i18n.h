@@ -0,0 +1,13 @@
+/*
+ * i18n.h: Minimal VDR stubs for the xmltv2vdr benchmark
+ *
+ */
+
+#ifndef __I18N_H
+#define __I18N_H
+
+#define tr(s)      (s)
+#define trNOOP(s)  (s)
+#define trVDR(s)   (s)
+
+#endif //__I18N_H
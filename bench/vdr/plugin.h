@@ -0,0 +1,52 @@
+/*
+ * plugin.h: Minimal VDR stubs for the xmltv2vdr benchmark
+ *
+ * Only declarations, the plugin class itself is not linked.
+ *
+ */
+
+#ifndef __PLUGIN_H
+#define __PLUGIN_H
+
+#include "i18n.h"
+#include "epg.h"
+#include "timers.h"
+#include "tools.h"
+
+class cOsdObject;
+class cMenuSetupPage;
+
+class cPlugin
+{
+public:
+    cPlugin(void);
+    virtual ~cPlugin();
+    const char *Name(void);
+    virtual const char *Version(void) = 0;
+    virtual const char *Description(void) = 0;
+    virtual const char *CommandLineHelp(void);
+    virtual bool ProcessArgs(int argc, char *argv[]);
+    virtual bool Initialize(void);
+    virtual bool Start(void);
+    virtual void Stop(void);
+    virtual void Housekeeping(void);
+    virtual void MainThreadHook(void);
+    virtual cString Active(void);
+    virtual time_t WakeupTime(void);
+    virtual const char *MainMenuEntry(void);
+    virtual cOsdObject *MainMenuAction(void);
+    virtual cMenuSetupPage *SetupMenu(void);
+    virtual bool SetupParse(const char *Name, const char *Value);
+    virtual bool Service(const char *Id, void *Data = NULL);
+    virtual const char **SVDRPHelpPages(void);
+    virtual cString SVDRPCommand(const char *Command, const char *Option, int &ReplyCode);
+    static const char *ConfigDirectory(const char *PluginName = NULL);
+};
+
+class cPluginManager
+{
+public:
+    static cPlugin *GetPlugin(const char *Name);
+};
+
+#endif //__PLUGIN_H
@@ -0,0 +1,101 @@
+/*
+ * thread.h: Minimal VDR stubs for the xmltv2vdr benchmark
+ *
+ */
+
+#ifndef __THREAD_H
+#define __THREAD_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+class cCondWait
+{
+private:
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool signaled;
+public:
+    cCondWait(void);
+    ~cCondWait();
+    static void SleepMs(int TimeoutMs);
+    bool Wait(int TimeoutMs = 0);
+    void Signal(void);
+};
+
+class cMutex;
+
+class cCondVar
+{
+private:
+    pthread_cond_t cond;
+public:
+    cCondVar(void);
+    ~cCondVar();
+    void Wait(cMutex &Mutex);
+    bool TimedWait(cMutex &Mutex, int TimeoutMs);
+    void Broadcast(void);
+};
+
+class cMutex
+{
+    friend class cCondVar;
+private:
+    pthread_mutex_t mutex;
+    int locked;
+public:
+    cMutex(void);
+    ~cMutex();
+    void Lock(void);
+    void Unlock(void);
+};
+
+typedef pid_t tThreadId;
+
+class cThread
+{
+private:
+    bool active;
+    bool running;
+    pthread_t childTid;
+    cMutex mutex;
+    char *description;
+    static void *StartThread(cThread *Thread);
+protected:
+    void SetPriority(int Priority);
+    void Lock(void)
+    {
+        mutex.Lock();
+    }
+    void Unlock(void)
+    {
+        mutex.Unlock();
+    }
+    virtual void Action(void) = 0;
+    bool Running(void)
+    {
+        return running;
+    }
+    void Cancel(int WaitSeconds = 0);
+public:
+    cThread(const char *Description = NULL, bool LowPriority = false);
+    virtual ~cThread();
+    void SetDescription(const char *Description, ...) __attribute__ ((format (printf, 2, 3)));
+    bool Start(void);
+    bool Active(void);
+    static tThreadId ThreadId(void);
+};
+
+class cMutexLock
+{
+private:
+    cMutex *mutex;
+    bool locked;
+public:
+    cMutexLock(cMutex *Mutex = NULL);
+    ~cMutexLock();
+    bool Lock(cMutex *Mutex);
+};
+
+#endif //__THREAD_H
@@ -0,0 +1,69 @@
+/*
+ * timers.h: Minimal VDR stubs for the xmltv2vdr benchmark
+ *
+ */
+
+#ifndef __TIMERS_H
+#define __TIMERS_H
+
+#include "channels.h"
+#include "epg.h"
+#include "tools.h"
+
+class cTimer : public cListObject
+{
+public:
+    bool Recording(void) const
+    {
+        return false;
+    }
+    const cEvent *Event(void) const
+    {
+        return NULL;
+    }
+    const cChannel *Channel(void) const
+    {
+        return NULL;
+    }
+    time_t StartTime(void) const
+    {
+        return 0;
+    }
+    static int TimeToInt(int t);
+    static time_t SetTime(time_t t, int SecondsFromMidnight);
+    static time_t IncDay(time_t t, int Days);
+    static int GetWDay(time_t t);
+    static cString PrintDay(time_t Day, int WeekDays, bool SingleByteChars);
+};
+
+class cTimers : public cList<cTimer>
+{
+private:
+    int beingEdited;
+public:
+    cTimers(void)
+    {
+        beingEdited = 0;
+    }
+    void IncBeingEdited(void)
+    {
+        beingEdited++;
+    }
+    void DecBeingEdited(void)
+    {
+        if (beingEdited) beingEdited--;
+    }
+    bool BeingEdited(void)
+    {
+        return beingEdited > 0;
+    }
+    void SetEvents(void) {}
+    bool Modified(int &State)
+    {
+        return false;
+    }
+};
+
+extern cTimers Timers;
+
+#endif //__TIMERS_H
@@ -0,0 +1,282 @@
+/*
+ * tools.h: Minimal VDR stubs for the xmltv2vdr benchmark
+ *
+ * Only the parts of VDR's tools.h which are used by the plugin sources.
+ *
+ */
+
+#ifndef __TOOLS_H
+#define __TOOLS_H
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <iconv.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define VDRVERSION  "1.7.30"
+#define VDRVERSNUM   10730
+
+typedef unsigned char uchar;
+
+extern int SysLogLevel;
+
+#define esyslog(a...) void( (SysLogLevel > 0) ? syslog_with_tid(LOG_ERR, a) : void() )
+#define isyslog(a...) void( (SysLogLevel > 1) ? syslog_with_tid(LOG_ERR, a) : void() )
+#define dsyslog(a...) void( (SysLogLevel > 2) ? syslog_with_tid(LOG_ERR, a) : void() )
+
+#define LOG_ERROR         esyslog("ERROR (%s,%d): %m", __FILE__, __LINE__)
+#define LOG_ERROR_STR(s)  esyslog("ERROR (%s,%d): %s: %m", __FILE__, __LINE__, s)
+
+void syslog_with_tid(int priority, const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+
+template<class T> inline T min(T a, T b)
+{
+    return a <= b ? a : b;
+}
+template<class T> inline T max(T a, T b)
+{
+    return a >= b ? a : b;
+}
+
+char *strcpyrealloc(char *dest, const char *src);
+char *strn0cpy(char *dest, const char *src, size_t n);
+char *strreplace(char *s, char c1, char c2);
+char *strreplace(char *s, const char *s1, const char *s2);
+char *strcatrealloc(char *dest, const char *src);
+char *strncatrealloc(char *dest, const char *src, size_t len);
+char *skipspace(const char *s);
+char *compactspace(char *s);
+bool isempty(const char *s);
+
+class cString
+{
+private:
+    char *s;
+public:
+    cString(const char *S = NULL, bool TakePointer = false);
+    cString(const cString &String);
+    virtual ~cString();
+    operator const void * () const
+    {
+        return s;
+    }
+    operator const char * () const
+    {
+        return s;
+    }
+    const char *operator*() const
+    {
+        return s;
+    }
+    cString &operator=(const cString &String);
+    cString &operator=(const char *String);
+    static cString sprintf(const char *fmt, ...) __attribute__ ((format (printf, 1, 2)));
+};
+
+class cCharSetConv
+{
+private:
+    iconv_t cd;
+    char *result;
+    size_t length;
+public:
+    cCharSetConv(const char *FromCode = NULL, const char *ToCode = NULL);
+    ~cCharSetConv();
+    const char *Convert(const char *From, char *To = NULL, size_t ToLength = 0);
+    static const char *SystemCharacterTable()
+    {
+        return "UTF-8";
+    }
+};
+
+class cListObject
+{
+private:
+    cListObject *prev, *next;
+public:
+    cListObject(void);
+    virtual ~cListObject();
+    virtual int Compare(const cListObject &ListObject) const
+    {
+        return 0;
+    }
+    void Append(cListObject *Object);
+    void Insert(cListObject *Object);
+    void Unlink(void);
+    int Index(void) const;
+    cListObject *Prev(void) const
+    {
+        return prev;
+    }
+    cListObject *Next(void) const
+    {
+        return next;
+    }
+};
+
+class cListBase
+{
+protected:
+    cListObject *objects, *lastObject;
+    cListBase(void);
+    int count;
+public:
+    virtual ~cListBase();
+    void Add(cListObject *Object, cListObject *After = NULL);
+    void Ins(cListObject *Object, cListObject *Before = NULL);
+    void Del(cListObject *Object, bool DeleteObject = true);
+    virtual void Move(int From, int To);
+    void Move(cListObject *From, cListObject *To);
+    virtual void Clear(void);
+    cListObject *Get(int Index) const;
+    int Count(void) const
+    {
+        return count;
+    }
+    void Sort(void);
+};
+
+template<class T> class cList : public cListBase
+{
+public:
+    T *Get(int Index) const
+    {
+        return (T *)cListBase::Get(Index);
+    }
+    T *First(void) const
+    {
+        return (T *)objects;
+    }
+    T *Last(void) const
+    {
+        return (T *)lastObject;
+    }
+    T *Prev(const T *object) const
+    {
+        return (T *)object->cListObject::Prev();
+    }
+    T *Next(const T *object) const
+    {
+        return (T *)object->cListObject::Next();
+    }
+};
+
+template<class T> class cVector
+{
+private:
+    mutable int allocated;
+    mutable int size;
+    mutable T *data;
+    cVector(const cVector &Vector) {}
+    cVector &operator=(const cVector &Vector)
+    {
+        return *this;
+    }
+    void Realloc(int Index) const
+    {
+        if (++Index > allocated)
+        {
+            data = (T *)realloc(data, Index * sizeof(T));
+            if (!data) abort();
+            for (int i = allocated; i < Index; i++)
+                data[i] = T(0);
+            allocated = Index;
+        }
+    }
+public:
+    cVector(int Allocated = 10)
+    {
+        allocated = 0;
+        size = 0;
+        data = NULL;
+        Realloc(Allocated);
+    }
+    virtual ~cVector()
+    {
+        free(data);
+    }
+    T& At(int Index) const
+    {
+        Realloc(Index);
+        if (Index >= size)
+            size = Index + 1;
+        return data[Index];
+    }
+    const T& operator[](int Index) const
+    {
+        return At(Index);
+    }
+    T& operator[](int Index)
+    {
+        return At(Index);
+    }
+    int Size(void) const
+    {
+        return size;
+    }
+    virtual void Insert(T Data, int Before = 0)
+    {
+        if (Before < size)
+        {
+            Realloc(size);
+            memmove(&data[Before + 1], &data[Before], (size - Before) * sizeof(T));
+            size++;
+            data[Before] = Data;
+        }
+        else
+            Append(Data);
+    }
+    virtual void Append(T Data)
+    {
+        if (size >= allocated)
+            Realloc(allocated * 3 / 2);
+        data[size++] = Data;
+    }
+    virtual void Remove(int Index)
+    {
+        if (Index < size - 1)
+            memmove(&data[Index], &data[Index + 1], (size - Index) * sizeof(T));
+        size--;
+    }
+    virtual void Clear(void)
+    {
+        for (int i = 0; i < size; i++)
+            data[i] = T(0);
+        size = 0;
+    }
+    void Sort(int (*Compare)(const void *, const void *))
+    {
+        qsort(data, size, sizeof(T), Compare);
+    }
+};
+
+inline int CompareStrings(const void *a, const void *b)
+{
+    return strcmp(*(const char **)a, *(const char **)b);
+}
+
+class cStringList : public cVector<char *>
+{
+public:
+    cStringList(int Allocated = 10): cVector<char *>(Allocated) {}
+    virtual ~cStringList();
+    int Find(const char *s) const;
+    void Sort(void)
+    {
+        cVector<char *>::Sort(CompareStrings);
+    }
+    virtual void Clear(void);
+};
+
+#endif //__TOOLS_H
@@ -60,7 +60,7 @@ char* cXMLTVEvent::removechar(char* s, char what)
 void cXMLTVEvent::SetSource(const char *Source)
 {
     source=strcpyrealloc(source, Source);
-    if (source)
+    if (source && !trusted)
     {
         source=removechar(source,'^');
         source=compactspace(source);
@@ -70,7 +70,7 @@ void cXMLTVEvent::SetSource(const char *Source)
 void cXMLTVEvent::SetChannelID(const char *ChannelID)
 {
     channelid=strcpyrealloc(channelid, ChannelID);
-    if (channelid)
+    if (channelid && !trusted)
     {
         channelid=removechar(channelid,'^');
         channelid=compactspace(channelid);
@@ -80,7 +80,7 @@ void cXMLTVEvent::SetChannelID(const char *ChannelID)
 void cXMLTVEvent::SetTitle(const char *Title)
 {
     title=strcpyrealloc(title, Title);
-    if (title)
+    if (title && !trusted)
     {
         title=removechar(title,'^');
         title=removechar(title,'\n');
@@ -92,7 +92,7 @@ void cXMLTVEvent::SetTitle(const char *Title)
 void cXMLTVEvent::SetAltTitle(const char *AltTitle)
 {
     alttitle=strcpyrealloc(alttitle, AltTitle);
-    if (alttitle)
+    if (alttitle && !trusted)
     {
         alttitle=removechar(alttitle,'^');
         alttitle=removechar(alttitle,'\n');
@@ -104,7 +104,7 @@ void cXMLTVEvent::SetAltTitle(const char *AltTitle)
 void cXMLTVEvent::SetOrigTitle(const char *OrigTitle)
 {
     origtitle=strcpyrealloc(origtitle, OrigTitle);
-    if (origtitle)
+    if (origtitle && !trusted)
     {
         origtitle=removechar(origtitle,'^');
         origtitle=compactspace(origtitle);
@@ -114,7 +114,7 @@ void cXMLTVEvent::SetOrigTitle(const char *OrigTitle)
 void cXMLTVEvent::SetShortText(const char *ShortText)
 {
     shorttext=strcpyrealloc(shorttext,ShortText);
-    if (shorttext)
+    if (shorttext && !trusted)
     {
         shorttext=removechar(shorttext,'^');
         shorttext=removechar(shorttext,'\n');
@@ -141,7 +141,7 @@ void cXMLTVEvent::AddDescription(const char *Description)
 void cXMLTVEvent::SetDescription(const char *Description)
 {
     description=strcpyrealloc(description, Description);
-    if (description)
+    if (description && !trusted)
     {
         description=removechar(description,'^');
         description=compactspace(description);
@@ -151,7 +151,7 @@ void cXMLTVEvent::SetDescription(const char *Description)
 void cXMLTVEvent::SetEITDescription(const char *EITDescription)
 {
     eitdescription=strcpyrealloc(eitdescription, EITDescription);
-    if (eitdescription)
+    if (eitdescription && !trusted)
     {
         eitdescription=removechar(eitdescription,'^');
         eitdescription=compactspace(eitdescription);
@@ -161,7 +161,7 @@ void cXMLTVEvent::SetEITDescription(const char *EITDescription)
 void cXMLTVEvent::SetCountry(const char *Country)
 {
     country=strcpyrealloc(country, Country);
-    if (country)
+    if (country && !trusted)
     {
         country=removechar(country,'^');
         country=compactspace(country);
@@ -171,7 +171,7 @@ void cXMLTVEvent::SetCountry(const char *Country)
 void cXMLTVEvent::SetAudio(const char *Audio)
 {
     audio=strcpyrealloc(audio, Audio);
-    if (audio)
+    if (audio && !trusted)
     {
         audio=removechar(audio,'^');
         audio=compactspace(audio);
@@ -191,13 +191,16 @@ void cXMLTVEvent::SetCredits(const char *Credits)
         char *val=strdup(tok);
         if (val)
         {
-            val=removechar(val,'^');
-            val=compactspace(val);
+            if (!trusted)
+            {
+                val=removechar(val,'^');
+                val=compactspace(val);
+            }
             credits.Append(val);
         }
         tok=strtok_r(NULL,delim,&sp);
     }
-    credits.Sort();
+    if (!trusted) credits.Sort(); // already sorted in db
     free(c);
 }
 
@@ -214,13 +217,16 @@ void cXMLTVEvent::SetCategory(const char *Category)
         char *val=strdup(tok);
         if (val)
         {
-            val=removechar(val,'^');
-            val=compactspace(val);
+            if (!trusted)
+            {
+                val=removechar(val,'^');
+                val=compactspace(val);
+            }
             category.Append(val);
         }
         tok=strtok_r(NULL,delim,&sp);
     }
-    category.Sort();
+    if (!trusted) category.Sort(); // already sorted in db
     free(c);
 }
 
@@ -237,8 +243,11 @@ void cXMLTVEvent::SetReview(const char *Review)
         char *val=strdup(tok);
         if (val)
         {
-            val=removechar(val,'^');
-            val=compactspace(val);
+            if (!trusted)
+            {
+                val=removechar(val,'^');
+                val=compactspace(val);
+            }
             review.Append(val);
         }
         tok=strtok_r(NULL,delim,&sp);
@@ -259,8 +268,11 @@ void cXMLTVEvent::SetRating(const char *Rating)
         char *val=strdup(tok);
         if (val)
         {
-            val=removechar(val,'^');
-            val=compactspace(val);
+            if (!trusted)
+            {
+                val=removechar(val,'^');
+                val=compactspace(val);
+            }
             rating.Append(val);
             char *rval=strchr(tok,'|');
             if (rval)
@@ -272,7 +284,7 @@ void cXMLTVEvent::SetRating(const char *Rating)
         }
         tok=strtok_r(NULL,delim,&sp);
     }
-    rating.Sort();
+    if (!trusted) rating.Sort(); // already sorted in db
     free(c);
 }
 
@@ -289,8 +301,11 @@ void cXMLTVEvent::SetVideo(const char *Video)
         char *val=strdup(tok);
         if (val)
         {
-            val=removechar(val,'^');
-            val=compactspace(val);
+            if (!trusted)
+            {
+                val=removechar(val,'^');
+                val=compactspace(val);
+            }
             video.Append(val);
         }
         tok=strtok_r(NULL,delim,&sp);
@@ -311,8 +326,11 @@ void cXMLTVEvent::SetPics(const char* Pics)
         char *val=strdup(tok);
         if (val)
         {
-            val=removechar(val,'^');
-            val=compactspace(val);
+            if (!trusted)
+            {
+                val=removechar(val,'^');
+                val=compactspace(val);
+            }
             pics.Append(val);
         }
         tok=strtok_r(NULL,delim,&sp);
@@ -333,13 +351,16 @@ void cXMLTVEvent::SetStarRating(const char *StarRating)
         char *val=strdup(tok);
         if (val)
         {
-            val=removechar(val,'^');
-            val=compactspace(val);
+            if (!trusted)
+            {
+                val=removechar(val,'^');
+                val=compactspace(val);
+            }
             starrating.Append(val);
         }
         tok=strtok_r(NULL,delim,&sp);
     }
-    starrating.Sort();
+    if (!trusted) starrating.Sort(); // already sorted in db
     free(c);
 }
 
@@ -409,6 +430,20 @@ void cXMLTVEvent::AddCategory(const char *Category)
     {
         val=removechar(val,'^');
         val=compactspace(val);
+        if ((val[0]=='G') && (val[1]==' '))
+        {
+            // dvb content codes "G xx,yy", parsed only once here
+            char *sp;
+            char *tok=strtok_r(&val[2],",",&sp);
+            while (tok)
+            {
+                unsigned int hval;
+                if (sscanf(tok,"%2x",&hval)==1) AddContent((uchar) hval);
+                tok=strtok_r(NULL,",",&sp);
+            }
+            free(val);
+            return;
+        }
         category.Append(val);
         category.Sort();
     }
@@ -478,15 +513,24 @@ void cXMLTVEvent::GetSQL(const char *Source, int SrcIdx, const char *ChannelID,
     const char *vi=video.toString();
     const char *pi=pics.toString();
 
+    char ct[2*MAXCONTENTS+4]="NULL"; // blob literal X^..^ (^ is replaced by ')
+    if (numcontents)
+    {
+        char *p=ct;
+        p+=sprintf(p,"X^");
+        for (int i=0; i<numcontents; i++) p+=sprintf(p,"%02x",contents[i]);
+        sprintf(p,"^");
+    }
+
     if (!eventid) return;
 
     if (asprintf(&sql_insert,
                  "INSERT OR FAIL INTO epg (src,channelid,eventid,starttime,duration,"\
                  "title,alttitle,origtitle,shorttext,description,country,year,credits,category,"\
-                 "review,rating,starrating,video,audio,season,episode,episodeoverall,pics,srcidx) "\
+                 "review,rating,starrating,video,audio,season,episode,episodeoverall,pics,srcidx,contents) "\
                  "VALUES (^%s^,^%s^,%u,%li,%i,"\
                  "^%s^,^%s^,^%s^,^%s^,^%s^,^%s^,%i,^%s^,^%s^,"\
-                 "^%s^,^%s^,^%s^,^%s^,^%s^,%i,%i,%i,^%s^,%i);"
+                 "^%s^,^%s^,^%s^,^%s^,^%s^,%i,%i,%i,^%s^,%i,%s);"
                  ,
                  Source,ChannelID,eventid,starttime,duration,title,
                  alttitle ? alttitle : "NULL",
@@ -497,7 +541,7 @@ void cXMLTVEvent::GetSQL(const char *Source, int SrcIdx, const char *ChannelID,
                  year,
                  cr,ca,re,ra,sr,vi,
                  audio ? audio : "NULL",
-                 season, episode, episodeoverall, pi, SrcIdx
+                 season, episode, episodeoverall, pi, SrcIdx, ct
                 )==-1)
     {
         sql_insert=NULL;
@@ -508,7 +552,7 @@ void cXMLTVEvent::GetSQL(const char *Source, int SrcIdx, const char *ChannelID,
                  "UPDATE epg SET duration=%i,starttime=%li,title=^%s^,alttitle=^%s^,origtitle=^%s^,"\
                  "shorttext=^%s^,description=^%s^,country=^%s^,year=%i,credits=^%s^,category=^%s^,"\
                  "review=^%s^,rating=^%s^,starrating=^%s^,video=^%s^,audio=^%s^,season=%i,episode=%i, "\
-                 "episodeoverall=%i,pics=^%s^,srcidx=%i " \
+                 "episodeoverall=%i,pics=^%s^,srcidx=%i,contents=%s " \
                  " where src=^%s^ and channelid=^%s^ and eventid=%u"
                  ,
                  duration,starttime,title,
@@ -520,7 +564,7 @@ void cXMLTVEvent::GetSQL(const char *Source, int SrcIdx, const char *ChannelID,
                  year,
                  cr,ca,re,ra,sr,vi,
                  audio ? audio : "NULL",
-                 season, episode, episodeoverall, pi, SrcIdx,
+                 season, episode, episodeoverall, pi, SrcIdx, ct,
                  Source,ChannelID,eventid
                 )==-1)
     {
@@ -619,6 +663,15 @@ void cXMLTVEvent::Clear()
     starttime=0;
     duration=0;
     eventid=eiteventid=0;
+    ClearLists();
+    season=0;
+    episode=0;
+    episodeoverall=0;
+    weakid=false;
+}
+
+void cXMLTVEvent::ClearLists()
+{
     video.Clear();
     credits.Clear();
     category.Clear();
@@ -626,11 +679,29 @@ void cXMLTVEvent::Clear()
     rating.Clear();
     starrating.Clear();
     pics.Clear();
-    season=0;
-    episode=0;
-    episodeoverall=0;
     parentalRating=0;
-    weakid=false;
+    memset(contents,0,sizeof(contents));
+    numcontents=0;
+}
+
+void cXMLTVEvent::AddContent(uchar Content)
+{
+    if (!Content) return;
+    for (int i=0; i<numcontents; i++)
+    {
+        if (contents[i]==Content) return;
+    }
+    if (numcontents<MAXCONTENTS) contents[numcontents++]=Content;
+}
+
+void cXMLTVEvent::SetContents(const void *Contents, int Len)
+{
+    memset(contents,0,sizeof(contents));
+    numcontents=0;
+    if (!Contents || (Len<=0)) return;
+    if (Len>MAXCONTENTS) Len=MAXCONTENTS;
+    memcpy(contents,Contents,Len);
+    numcontents=Len;
 }
 
 cXMLTVEvent::cXMLTVEvent()
@@ -646,6 +717,7 @@ cXMLTVEvent::cXMLTVEvent()
     country=NULL;
     origtitle=NULL;
     audio=NULL;
+    trusted=false;
     Clear();
 }
 
@@ -11,6 +11,8 @@
 #include <time.h>
 #include <vdr/epg.h>
 
+#define MAXCONTENTS 4 // same as MaxEventContents in VDR >= 1.7.12
+
 class cXMLTVStringList : public cVector<char *>
 {
 private:
@@ -61,11 +63,20 @@ private:
     cXMLTVStringList starrating;
     cXMLTVStringList pics;
     int parentalRating;
+    uchar contents[MAXCONTENTS];
+    int numcontents;
+    bool trusted;
     char *removechar(char *s, char what);
 public:
     cXMLTVEvent();
     ~cXMLTVEvent();
     void Clear();
+    void ClearLists();
+    void SetTrusted(bool Trusted)
+    {
+        // values are already sanitized (e.g. read back from epg.db)
+        trusted=Trusted;
+    }
     void SetSource(const char *Source);
     void SetChannelID(const char *ChannelID);
     void SetTitle(const char *Title);
@@ -84,6 +95,7 @@ public:
     void AddRating(const char *System, const char *Rating);
     void AddStarRating(const char *System, const char *Rating);
     void AddPics(const char *Pic);
+    void AddContent(uchar Content);
     void SetCredits(const char *Credits);
     void SetCategory(const char *Category);
     void SetReview(const char *Review);
@@ -91,6 +103,7 @@ public:
     void SetStarRating(const char *StarRating);
     void SetVideo(const char *Video);
     void SetPics(const char *Pics);
+    void SetContents(const void *Contents, int Len);
     void CreateEventID(time_t StartTime);
     void GetSQL(const char *Source, int SrcIdx, const char *ChannelID, char **Insert, char **Update);
     bool WeakID()
@@ -105,6 +118,14 @@ public:
     {
         return &category;
     }
+    int NumContents()
+    {
+        return numcontents;
+    }
+    const uchar *Contents()
+    {
+        return contents;
+    }
     cXMLTVStringList *Review()
     {
         return &review;
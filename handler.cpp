@@ -0,0 +1,304 @@
+/*
+ * handler.cpp: A plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <unistd.h>
+#include <sqlite3.h>
+
+#include "xmltv2vdr.h"
+#include "debug.h"
+
+cEPGEventCache::cEPGEventCache()
+{
+    for (int i=0; i<EPGHANDLER_EVENTS; i++) entries[i]=entry(); // tChannelID has a constructor
+}
+
+uint64_t cEPGEventCache::fingerprint(const cEvent *Event)
+{
+    // FNV-1a over everything VDR (or we) may change on a repeated event
+    uint64_t fp=14695981039346656037ULL;
+#define FPADD(v) fp=(fp ^ (uint64_t) (v))*1099511628211ULL
+    FPADD(Event->TableID());
+    FPADD(Event->Version());
+    FPADD(Event->Duration());
+    for (const char *p=Event->Title(); p && *p; p++) FPADD((unsigned char) *p);
+    FPADD(0);
+    for (const char *p=Event->ShortText(); p && *p; p++) FPADD((unsigned char) *p);
+    FPADD(0);
+    for (const char *p=Event->Description(); p && *p; p++) FPADD((unsigned char) *p);
+#undef FPADD
+    return fp;
+}
+
+struct cEPGEventCache::entry *cEPGEventCache::slot(const cEvent *Event)
+{
+    // two-way set associative, returns the first entry of the set
+    tChannelID channelid=Event->ChannelID();
+    uint32_t hash=(uint32_t) channelid.Source();
+    hash=hash*31+(uint32_t) channelid.Nid();
+    hash=hash*31+(uint32_t) channelid.Tid();
+    hash=hash*31+(uint32_t) channelid.Sid();
+    hash=hash*31+(uint32_t) Event->EventID();
+    hash=hash*31+(uint32_t) Event->StartTime();
+    hash^=hash>>16;
+    hash*=0x45d9f3b;
+    hash^=hash>>16;
+    return &entries[hash & (EPGHANDLER_EVENTS-2)];
+}
+
+bool cEPGEventCache::Lookup(const cEvent *Event, uint32_t Generation)
+{
+    struct entry *set=slot(Event);
+    for (int i=0; i<2; i++)
+    {
+        struct entry *e=&set[i];
+        if (!e->used) continue;
+        if (e->eventid!=Event->EventID()) continue;
+        if (e->start!=Event->StartTime()) continue;
+        if (!(e->channelid==Event->ChannelID())) continue;
+        if (e->generation!=Generation) return false;
+        return (e->fingerprint==fingerprint(Event));
+    }
+    return false;
+}
+
+void cEPGEventCache::Add(const cEvent *Event, uint32_t Generation)
+{
+    // reuse the entry of this event, else a free or outdated one,
+    // else the second entry of the set is replaced
+    struct entry *set=slot(Event);
+    struct entry *e=NULL;
+    for (int i=0; i<2 && !e; i++)
+    {
+        if (set[i].used && (set[i].eventid==Event->EventID()) && (set[i].start==Event->StartTime()) &&
+                (set[i].channelid==Event->ChannelID())) e=&set[i];
+    }
+    for (int i=0; i<2 && !e; i++)
+    {
+        if (!set[i].used || (set[i].generation!=Generation)) e=&set[i];
+    }
+    if (!e)
+    {
+        set[1]=set[0];
+        e=&set[0];
+    }
+    e->channelid=Event->ChannelID();
+    e->eventid=Event->EventID();
+    e->start=Event->StartTime();
+    e->fingerprint=fingerprint(Event);
+    e->generation=Generation;
+    e->used=true;
+}
+
+// -------------------------------------------------------------
+
+cEPGHandler::cEPGHandler(cGlobals* Global): import(Global)
+{
+    g=Global;
+    epall=0;
+    maps=Global->EPGMappingSnapshots();
+    sources=Global->EPGSources();
+    stats=Global->HandlerStats();
+    import.SetDBStats(stats);
+    db=NULL;
+    now=0;
+    dbexists=false;
+    dbchecked=0;
+    dbgeneration=0;
+}
+
+cEPGHandler::~cEPGHandler()
+{
+    closedb();
+}
+
+void cEPGHandler::closedb()
+{
+    if (!db) return;
+    import.Commit(NULL,db);
+    import.FinalizeStatements();
+    sqlite3_close(db);
+    db=NULL;
+}
+
+bool cEPGHandler::checkdb()
+{
+    // stat() epg.db only if the generation changed or some time passed
+    uint32_t generation=g->DBGeneration();
+    if (dbchecked && (generation==dbgeneration) && (now>=dbchecked) &&
+            (now<dbchecked+EPGHANDLER_DBCHECK)) return dbexists;
+    dbexists=import.DBExists();
+    dbchecked=now ? now : time(NULL);
+    dbgeneration=generation;
+    if (!dbexists) closedb();
+    else if (db && import.DBReplaced()) closedb(); // epg.db was recreated
+    return dbexists;
+}
+
+bool cEPGHandler::IgnoreChannel(const cChannel* Channel)
+{
+    cHandlerTimer timer(stats,HANDLER_IGNORECHANNEL);
+    now=time(NULL);
+    if (!maps) return false;
+    if (!Channel) return false;
+    cEPGMappingsReader reader(maps);
+    return reader->IgnoreChannel(Channel);
+}
+
+bool cEPGHandler::check4proc(cEvent *event, bool &spth, cEPGMappingsReader &reader, cEPGMapping **map)
+{
+    if (map) *map=NULL;
+    spth=false;
+    if (!event) return false;
+    if (now>(event->StartTime()+event->Duration())) return false; // event in the past?
+    if (!maps) return false;
+    if (!checkdb()) return false;
+
+    cEPGMapping *t_map=reader->GetMap(event->ChannelID());
+    if (!t_map)
+    {
+        if (!epall) return false;
+        if (!event->HasTimer()) return false;
+        if (!event->ShortText()) return false;
+        spth=true;
+    }
+    if (map) *map=t_map;
+    return true;
+}
+
+bool cEPGHandler::SetShortText(cEvent* Event, const char* ShortText)
+{
+    cHandlerTimer timer(stats,HANDLER_SETSHORTTEXT);
+    // prevent setting empty shorttext
+    if (!ShortText) return true;
+    // prevent setting empty shorttext
+    if (!strlen(ShortText)) return true;
+    // prevent setting shorttext equal to title
+    if (Event->Title() && !strcasecmp(Event->Title(),ShortText)) return true;
+    if (!Event->ShortText())
+    {
+#if VDRDEBUG
+        tsyslog("{%5i} setting stext (%s) of '%s'",Event->EventID(),
+                ShortText,Event->Title());
+#endif
+        return false; // no shorttext? new event! let VDR handle this..
+    }
+    return true;
+}
+
+bool cEPGHandler::SetDescription(cEvent* Event, const char* Description)
+{
+    cHandlerTimer timer(stats,HANDLER_SETDESCRIPTION);
+    bool seth;
+    cEPGMappingsReader reader(maps);
+    if (!check4proc(Event,seth,reader,NULL)) return false;
+
+    if (import.WasChanged(Event))
+    {
+        // ok we already changed this event!
+        if (!Description) return true; // prevent setting nothing to description
+        int len=strlen(Description);
+        if (!len) return true; // prevent setting nothing to description
+        if (!strcasestr(Event->Description(),Description))
+        {
+            // eit description changed -> set it
+            tsyslog("{%5i} %schanging descr of '%s'",Event->EventID(),seth ? "*" : "",
+                    Event->Title());
+            return false;
+        }
+#ifdef VDRDEBUG
+        tsyslog("{%5i} %salready seen descr '%s'",Event->EventID(),seth ? "*" : "",
+                Event->Title());
+#endif
+        return true;
+    }
+    tsyslog("{%5i} %ssetting descr of '%s'",Event->EventID(),seth ? "*" : "",
+            Event->Title());
+    return false;
+}
+
+
+bool cEPGHandler::HandleEvent(cEvent* Event)
+{
+    cHandlerTimer timer(stats,HANDLER_HANDLEEVENT);
+    if (!Event) return false;
+
+    // broadcasters repeat their events every few seconds
+    uint32_t generation=g->DBGeneration();
+    if (eventcache.Lookup(Event,generation))
+    {
+        if (stats) stats->AddDB(DBOP_CACHED);
+        return false;
+    }
+
+    bool special_epall_timer_handling;
+    cEPGMapping *map;
+    cEPGMappingsReader reader(maps); // map is valid as long as we hold the reader
+    if (!check4proc(Event,special_epall_timer_handling,reader,&map)) return false;
+
+    int Flags=0;
+    cString ChannelID=Event->ChannelID().ToString();
+
+    if (special_epall_timer_handling)
+    {
+        Flags=USE_SEASON;
+    }
+    else
+    {
+        // map is always set if seth==false
+        Flags=map->Flags();
+    }
+
+    if (!db && (ioprio_set(1,getpid(),7 | 3 << 13)==-1))
+    {
+        tsyslog("failed to set ioprio to 3,7");
+    }
+
+    cEPGSource *source=NULL;
+    cXMLTVEvent *xevent=import.SearchXMLTVEvent(&db,ChannelID,Event,Flags,&row);
+    if (!xevent)
+    {
+        if (!epall)
+        {
+            if (db) eventcache.Add(Event,generation);
+            return false;
+        }
+        source=sources->GetSource(EITSOURCE);
+        if (!source) tsyslog("no source for %s",EITSOURCE);
+        bool useeptext=((epall & EPLIST_USE_STEXTITLE)==EPLIST_USE_STEXTITLE);
+        if (useeptext) Flags|=(USE_SHORTTEXT|OPT_SEASON_STEXTITLE);
+        xevent=import.AddXMLTVEvent(source,db,ChannelID,Event,Event->Description(),useeptext);
+        if (!xevent)
+        {
+            if (db) eventcache.Add(Event,generation);
+            return false;
+        }
+    }
+    else
+    {
+        source=sources->GetSource(xevent->Source());
+    }
+    if (!source)
+    {
+        tsyslog("no source for %s",xevent->Source());
+        if (xevent!=&row) delete xevent;
+        return false;
+    }
+
+    import.PutEvent(source,db,NULL,Event,xevent,Flags);
+    if (xevent!=&row) delete xevent;
+    eventcache.Add(Event,generation); // as we left it
+    return false; // let other handlers change this event
+}
+
+bool cEPGHandler::SortSchedule(cSchedule* UNUSED(Schedule))
+{
+    cHandlerTimer timer(stats,HANDLER_SORTSCHEDULE);
+    // the database stays open, the cached statements are reused with
+    // the next section
+    if (db) import.Commit(NULL,db);
+    return false; // we dont sort!
+}
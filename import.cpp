@@ -19,6 +19,7 @@
 #include "debug.h"
 
 extern char *strcatrealloc(char *, const char*);
+extern char *strncatrealloc(char *, const char *, size_t);
 
 struct cImport::split cImport::split(char *in, char delim)
 {
@@ -79,29 +80,208 @@ char *cImport::RemoveNonASCII(const char *src)
     return dst;
 }
 
+cConvCache::cConvCache(const char *FromCode, const char *ToCode)
+{
+    memset(entries,0,sizeof(entries));
+    tick=0;
+    if (ToCode && (!strcasecmp(ToCode,FromCode) || !strcasecmp(ToCode,"UTF8")))
+    {
+        conv=NULL; // identity, no need to call iconv at all
+    }
+    else
+    {
+        conv=new cCharSetConv(FromCode,ToCode);
+    }
+}
+
+cConvCache::~cConvCache()
+{
+    for (int i=0; i<CONVCACHE_SIZE; i++)
+    {
+        free(entries[i].src);
+        free(entries[i].dst);
+    }
+    delete conv;
+}
+
+const char *cConvCache::Convert(const char *From, bool Cache)
+{
+    // the result is valid until the next call
+    if (!conv || !From || !*From) return From;
+    if (!Cache) return conv->Convert(From);
+
+    unsigned int hash=2166136261u;
+    size_t len=0;
+    for (const unsigned char *p=(const unsigned char *) From; *p; p++, len++)
+    {
+        hash=(hash ^ *p)*16777619u;
+    }
+    if (len>=CONVCACHE_MAXLEN) return conv->Convert(From);
+
+    tick++;
+    int lru=0;
+    for (int i=0; i<CONVCACHE_SIZE; i++)
+    {
+        if (entries[i].src && (entries[i].hash==hash) && !strcmp(entries[i].src,From))
+        {
+            entries[i].used=tick;
+            return entries[i].dst;
+        }
+        if (entries[i].used<entries[lru].used) lru=i;
+    }
+
+    const char *to=conv->Convert(From);
+    char *src=strdup(From);
+    char *dst=strdup(to);
+    if (!src || !dst)
+    {
+        free(src);
+        free(dst);
+        return to;
+    }
+    free(entries[lru].src);
+    free(entries[lru].dst);
+    entries[lru].hash=hash;
+    entries[lru].used=tick;
+    entries[lru].src=src;
+    entries[lru].dst=dst;
+    return dst;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cScheduleIndex::cScheduleIndex()
+{
+    events=NULL;
+    numevents=allocated=0;
+    slots=NULL;
+    slotbits=allocslots=0;
+    valid=false;
+}
+
+cScheduleIndex::~cScheduleIndex()
+{
+    free(events);
+    free(slots);
+}
+
+int cScheduleIndex::compare(const void *a, const void *b)
+{
+    const cEvent *ea=*(const cEvent **) a;
+    const cEvent *eb=*(const cEvent **) b;
+    if (ea->StartTime()==eb->StartTime()) return 0;
+    return (ea->StartTime()<eb->StartTime()) ? -1 : 1;
+}
+
+void cScheduleIndex::Build(const cSchedule *Schedule)
+{
+    // called once per channel, the schedule must stay locked (and unchanged!)
+    Clear();
+    if (!Schedule || !Schedule->Events()) return;
+    int cnt=Schedule->Events()->Count();
+    if (cnt>allocated)
+    {
+        cEvent **tmp=(cEvent **) realloc(events,cnt*sizeof(cEvent *));
+        if (!tmp) return;
+        events=tmp;
+        allocated=cnt;
+    }
+    int bits=4;
+    while ((1<<bits)<2*cnt) bits++;
+    if ((1<<bits)>allocslots)
+    {
+        int *tmp=(int *) realloc(slots,(1<<bits)*sizeof(int));
+        if (!tmp) return;
+        slots=tmp;
+        allocslots=1<<bits;
+    }
+    slotbits=bits;
+    memset(slots,0,(1<<bits)*sizeof(int));
+
+    bool sorted=true;
+    for (cEvent *p=Schedule->Events()->First(); p && (numevents<cnt); p=Schedule->Events()->Next(p))
+    {
+        if (numevents && (p->StartTime()<events[numevents-1]->StartTime())) sorted=false;
+        events[numevents++]=p;
+    }
+    if (!sorted) qsort(events,numevents,sizeof(cEvent *),compare);
+
+    // like cSchedule::GetEvent the first event in the list wins
+    unsigned int mask=(1<<bits)-1;
+    for (cEvent *p=Schedule->Events()->First(); p; p=Schedule->Events()->Next(p))
+    {
+        unsigned int s=slot(p->StartTime());
+        while (slots[s] && (events[slots[s]-1]->StartTime()!=p->StartTime())) s=(s+1) & mask;
+        if (slots[s]) continue;
+        int i=First(p->StartTime());
+        while ((i<numevents) && (events[i]!=p)) i++;
+        if (i<numevents) slots[s]=i+1;
+    }
+    valid=true;
+}
+
+cEvent *cScheduleIndex::Get(time_t StartTime) const
+{
+    if (!numevents) return NULL;
+    unsigned int mask=(1<<slotbits)-1;
+    unsigned int s=slot(StartTime);
+    while (slots[s])
+    {
+        cEvent *p=events[slots[s]-1];
+        if (p->StartTime()==StartTime) return p;
+        s=(s+1) & mask;
+    }
+    return NULL;
+}
+
+int cScheduleIndex::First(time_t From) const
+{
+    // index of the first event with starttime>=From
+    int lo=0,hi=numevents;
+    while (lo<hi)
+    {
+        int mid=(lo+hi)/2;
+        if (events[mid]->StartTime()<From) lo=mid+1;
+        else hi=mid;
+    }
+    return lo;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
 cEvent *cImport::SearchVDREventByTitle(cEPGSource *source, cSchedule* schedule, const char *Title, time_t StartTime,
-                                       int Duration, int hint)
+                                       int Duration, int hint, int offset, const cScheduleIndex *Index,
+                                       bool *Exact)
 {
     const char *cxTitle=conv->Convert(Title);
 
     // 2nd with StartTime
-    cEvent *f=(cEvent *) schedule->GetEvent((tEventID) 0,StartTime+hint);
+    cEvent *f=Index ? Index->Get(StartTime+hint) : (cEvent *) schedule->GetEvent((tEventID) 0,StartTime+hint);
     if (f)
     {
         if (!strcasecmp(f->Title(),cxTitle))
         {
+            if (Exact) *Exact=true;
             return f;
         }
     }
+    if (Exact) *Exact=false;
     // 3rd with StartTime +/- TimeDiff
     int maxdiff=INT_MAX;
     int eventTimeDiff=720;
     if (Duration && eventTimeDiff>=Duration) eventTimeDiff/=3;
     if (eventTimeDiff<100) eventTimeDiff=100;
 
-    for (cEvent *p = schedule->Events()->First(); p; p = schedule->Events()->Next(p))
+    // center the window with the learned time offset of the channel
+    time_t center=StartTime+offset;
+
+    // with an index only the events inside the window are visited
+    int idx=Index ? Index->First(center-eventTimeDiff) : 0;
+    cEvent *p=Index ? Index->Event(idx) : schedule->Events()->First();
+    for (; p; p=Index ? Index->Event(++idx) : schedule->Events()->Next(p))
     {
-        int diff=abs((int) difftime(p->StartTime(),StartTime));
+        if (Index && (p->StartTime()>center+eventTimeDiff)) break;
+        int diff=abs((int) difftime(p->StartTime(),center));
         if (diff<=eventTimeDiff)
         {
             // found event with exact the same title
@@ -173,30 +353,47 @@ cEvent *cImport::SearchVDREventByTitle(cEPGSource *source, cSchedule* schedule,
     return f;
 }
 
-cEvent *cImport::SearchVDREvent(cEPGSource *source, cSchedule* schedule, cXMLTVEvent *xevent, bool append, int hint)
+cEvent *cImport::SearchVDREvent(cEPGSource *source, cSchedule* schedule, cXMLTVEvent *xevent, bool append, int hint,
+                                int offset, const cScheduleIndex *Index)
 {
     if (!source) return NULL;
     if (!schedule) return NULL;
     if (!xevent) return NULL;
 
+    cSourceStats *stats=source->Stats();
+    cStatTimer matchtime;
     cEvent *f=NULL;
+    int method=STAT_MATCHNONE;
 
     // try to find an event,
     // 1st with our own EventID
     if (xevent->EITEventID()) f=(cEvent *) schedule->GetEvent(xevent->EITEventID());
-    if (f) return f;
+    if (f) method=STAT_MATCHEITID;
 
-    if (xevent->EventID() && append) f=(cEvent *) schedule->GetEvent(xevent->EventID());
-    if (f) return f;
+    if (!f && xevent->EventID() && append)
+    {
+        f=(cEvent *) schedule->GetEvent(xevent->EventID());
+        if (f) method=STAT_MATCHEVENTID;
+    }
 
-    f=SearchVDREventByTitle(source, schedule, xevent->Title(), xevent->StartTime(),
-                            xevent->Duration(), hint);
-    if (f) return f;
+    if (!f)
+    {
+        bool exact;
+        f=SearchVDREventByTitle(source, schedule, xevent->Title(), xevent->StartTime(),
+                                xevent->Duration(), hint, offset, Index, &exact);
+        if (f) method=exact ? STAT_MATCHEXACT : STAT_MATCHFUZZY;
+    }
 
-    if (!xevent->AltTitle()) return NULL;
+    if (!f && xevent->AltTitle())
+    {
+        f=SearchVDREventByTitle(source, schedule, xevent->AltTitle(), xevent->StartTime(),
+                                xevent->Duration(), hint, offset, Index);
+        if (f) method=STAT_MATCHALTTITLE;
+    }
 
-    return SearchVDREventByTitle(source, schedule, xevent->AltTitle(), xevent->StartTime(),
-                                 xevent->Duration(), hint);
+    stats->Add(method);
+    stats->Add(STAT_MATCHTIME,matchtime.Elapsed());
+    return f;
 }
 
 cEvent *cImport::GetEventBefore(cSchedule* schedule, time_t start)
@@ -246,7 +443,7 @@ char *cImport::Add2Description(char *description, const char *Name, const char *
 char *cImport::Add2Description(char *description, const char *Name, int Value)
 {
     char *value=NULL;
-    if (asprintf(&value,"%i",Value)==-1) return false;
+    if (asprintf(&value,"%i",Value)==-1) return description;
     description = strcatrealloc(description,Name);
     description = strcatrealloc(description,": ");
     description = strcatrealloc(description,value);
@@ -302,430 +499,286 @@ bool cImport::WasChanged(cEvent* Event)
 
 void cImport::LinkPictures(const char *Source, cXMLTVStringList *Pics, tEventID DestID, tChannelID ChanID, bool MakeOld)
 {
-    // source-pics are located in /var/lib/epgsources/%SOURCE%-img/
-    // dest-pics are located in imgdir (default /var/cache/vdr/epgimages)
+    // the filesystem work is done in the background by the picture linker
+    if (!g->PictureLinker()) return;
+    g->PictureLinker()->Add(Source,Pics,DestID,ChanID,MakeOld);
+}
 
-    for (int i=0; i<Pics->Size(); i++)
+char *cImport::Render(char *description, const cRenderPlan *Plan, cXMLTVEvent *xEvent)
+{
+    int Flags=Plan->flags;
+    for (int s=0; s<Plan->numsteps; s++)
     {
-        char *pic=(*Pics)[i];
-
-        char *ext=strrchr(pic,'.');
-        if (!ext) continue;
-
-        ext++;
-        char *dst,*dstold=NULL;
-        int ret;
-
-        char *src;
-        if (asprintf(&src,"/var/lib/epgsources/%s-img/%s",Source,pic)==-1) return;
-
-        if (MakeOld)
+        const tRenderStep *step=&Plan->steps[s];
+        switch (step->what)
         {
-            if (!i)
-            {
-                ret=asprintf(&dstold,"%s/%i.%s",g->ImgDir(),DestID,ext);
-            }
-            else
-            {
-                ret=asprintf(&dstold,"%s/%i_%i.%s",g->ImgDir(),DestID,i,ext);
-            }
-            if (ret==-1)
-            {
-                free(src);
-                return;
-            }
-        }
-
-        if (!i)
-        {
-            ret=asprintf(&dst,"%s/%s_%i.%s",g->ImgDir(),*ChanID.ToString(),DestID,ext);
-        }
-        else
-        {
-            ret=asprintf(&dst,"%s/%s_%i_%i.%s",g->ImgDir(),*ChanID.ToString(),DestID,i,ext);
-        }
-        if (ret==-1)
-        {
-            free(src);
-            if (dstold) free(dstold);
-            return;
-        }
-
-        struct stat statbuf;
-        if (MakeOld)
+        case USE_LONGTEXT:
         {
-            if (stat(dstold,&statbuf)!=-1)
-            {
-                unlink(dstold);
-            }
-            if (symlink(src,dstold)==-1)
-            {
-                if (!i)
-                {
-                    tsyslog("failed to link %s to %i.%s",pic,DestID,ext);
-                }
-                else
-                {
-                    tsyslog("failed to link %s to %i_%i.%s",pic,DestID,i,ext);
-                }
-            }
-            else
+            bool lta=false;
+            if (((Flags & USE_LONGTEXT)==USE_LONGTEXT) || ((Flags & OPT_APPEND)==OPT_APPEND))
             {
-                if (!i)
-                {
-                    tsyslog("linked %s to %i.%s",pic,DestID,ext);
-                }
-                else
+                if (xEvent->Description() && (strlen(xEvent->Description())>0))
                 {
-                    tsyslog("linked %s to %i_%i.%s",pic,DestID,i,ext);
+                    description=Add2Description(description,xEvent->Description());
+                    lta=true;
                 }
             }
-        }
-
-        if (stat(dst,&statbuf)!=-1)
-        {
-            unlink(dst);
-        }
-        if (symlink(src,dst)==-1)
-        {
-            if (!i)
-            {
-                tsyslog("failed to link %s to %s_%i.%s",pic,*ChanID.ToString(),DestID,ext);
-            }
-            else
-            {
-                tsyslog("failed to link %s to %s_%i_%i.%s",pic,*ChanID.ToString(),DestID,i,ext);
-            }
-        }
-        else
-        {
-            if (!i)
-            {
-                tsyslog("linked %s to %s_%i.%s",pic,*ChanID.ToString(),DestID,ext);
-            }
-            else
-            {
-                tsyslog("linked %s to %s_%i_%i.%s",pic,*ChanID.ToString(),DestID,i,ext);
-            }
-        }
-
-        free(src);
-        free(dst);
-        if (dstold) free(dstold);
 
-    }
-}
-
-char *cImport::Add2Description(char *description, cXMLTVEvent *xEvent, int Flags, int what)
-{
-    if (what==USE_LONGTEXT)
-    {
-        bool lta=false;
-        if (((Flags & USE_LONGTEXT)==USE_LONGTEXT) || ((Flags & OPT_APPEND)==OPT_APPEND))
-        {
-            if (xEvent->Description() && (strlen(xEvent->Description())>0))
+            if (!lta && xEvent->EITDescription() && (strlen(xEvent->EITDescription())>0))
             {
-                description=Add2Description(description,xEvent->Description());
-                lta=true;
+                description=Add2Description(description,xEvent->EITDescription());
             }
+            description=Add2Description(description,"\n");
+            break;
         }
 
-        if (!lta && xEvent->EITDescription() && (strlen(xEvent->EITDescription())>0))
-        {
-            description=Add2Description(description,xEvent->EITDescription());
-        }
-        description=Add2Description(description,"\n");
-    }
-
-    if ((what==USE_CREDITS) && ((Flags & USE_CREDITS)==USE_CREDITS))
-    {
-        cXMLTVStringList *credits=xEvent->Credits();
-        if (credits->Size())
+        case USE_CREDITS:
         {
-            cTEXTMapping *oldtext=NULL;
+            cXMLTVStringList *credits=xEvent->Credits();
+            if (!credits->Size()) break;
+            bool list=((Flags & CREDITS_LIST)==CREDITS_LIST);
+            const char *oldtext=NULL;
+            bool first=true;
             for (int i=0; i<credits->Size(); i++)
             {
-                char *ctype=strdup((*credits)[i]);
-                if (ctype)
+                const char *ctype=(*credits)[i];
+                const char *cval=strchr(ctype,'|');
+                if (!cval) continue;
+                int tlen=cval-ctype;
+                cval++;
+
+                char type[64];
+                if (tlen>=(int) sizeof(type)) continue;
+                memcpy(type,ctype,tlen);
+                type[tlen]=0;
+
+                bool actor=!strcasecmp(type,"actor");
+                bool director=!strcasecmp(type,"director");
+                if (actor && ((Flags & CREDITS_ACTORS)!=CREDITS_ACTORS)) continue;
+                if (director && ((Flags & CREDITS_DIRECTORS)!=CREDITS_DIRECTORS)) continue;
+                if (!actor && !director && ((Flags & CREDITS_OTHERS)!=CREDITS_OTHERS)) continue;
+
+                const char *text=Plan->Label(type);
+                if (!text) continue;
+                if (list)
                 {
-                    char *cval=strchr(ctype,'|');
-                    if (cval)
+                    if (first || (oldtext!=text))
                     {
-                        *cval=0;
-                        cval++;
-                        bool add=true;
-                        if (((Flags & CREDITS_ACTORS)!=CREDITS_ACTORS) &&
-                                (!strcasecmp(ctype,"actor"))) add=false;
-                        if (((Flags & CREDITS_DIRECTORS)!=CREDITS_DIRECTORS) &&
-                                (!strcasecmp(ctype,"director"))) add=false;
-                        if (((Flags & CREDITS_OTHERS)!=CREDITS_OTHERS) &&
-                                (add) && (strcasecmp(ctype,"actor")) &&
-                                (strcasecmp(ctype,"director"))) add=false;
-                        if (add)
+                        if (!first)
                         {
-                            cTEXTMapping *text=g->TEXTMappings()->GetMap(ctype);
-                            if ((Flags & CREDITS_LIST)==CREDITS_LIST)
-                            {
-                                if (oldtext!=text)
-                                {
-                                    if (oldtext)
-                                    {
-                                        description=RemoveLastCharFromDescription(description);
-                                        description=RemoveLastCharFromDescription(description);
-                                        description=Add2Description(description,"\n");
-                                    }
-                                    description=Add2Description(description,text->Value());
-                                    description=Add2Description(description,": ");
-                                }
-                                description=Add2Description(description,cval);
-                                description=Add2Description(description,", ");
-                            }
-                            else
-                            {
-                                if (text)
-                                {
-                                    description=Add2Description(description,text->Value(),cval);
-                                }
-                            }
-                            oldtext=text;
+                            description=RemoveLastCharFromDescription(description);
+                            description=RemoveLastCharFromDescription(description);
+                            description=Add2Description(description,"\n");
                         }
+                        description=Add2Description(description,text);
+                        description=Add2Description(description,": ");
                     }
-                    free(ctype);
+                    description=Add2Description(description,cval);
+                    description=Add2Description(description,", ");
                 }
+                else
+                {
+                    description=Add2Description(description,text,cval);
+                }
+                oldtext=text;
+                first=false;
             }
-            if ((oldtext) && ((Flags & CREDITS_LIST)==CREDITS_LIST))
+            if (!first && list)
             {
                 description=RemoveLastCharFromDescription(description);
                 description=RemoveLastCharFromDescription(description);
                 description=Add2Description(description,"\n");
             }
+            break;
         }
-    }
 
-    if ((what==USE_COUNTRYDATE) && ((Flags & USE_COUNTRYDATE)==USE_COUNTRYDATE))
-    {
-        if (xEvent->Country())
-        {
-            cTEXTMapping *text=g->TEXTMappings()->GetMap("country");
-            if (text) description=Add2Description(description,text->Value(),xEvent->Country());
-        }
+        case USE_COUNTRYDATE:
+            if (xEvent->Country() && step->label[0])
+                description=Add2Description(description,step->label[0],xEvent->Country());
+            if (xEvent->Year() && step->label[1])
+                description=Add2Description(description,step->label[1],xEvent->Year());
+            break;
 
-        if (xEvent->Year())
-        {
-            cTEXTMapping *text=g->TEXTMappings()->GetMap("year");
-            if (text) description=Add2Description(description,text->Value(),xEvent->Year());
-        }
-    }
-    if ((what==USE_ORIGTITLE) && ((Flags & USE_ORIGTITLE)==USE_ORIGTITLE) &&
-            (xEvent->OrigTitle()))
-    {
-        cTEXTMapping *text=g->TEXTMappings()->GetMap("originaltitle");
-        if (text) description=Add2Description(description,text->Value(),xEvent->OrigTitle());
-    }
-    if ((what==USE_CATEGORIES) && ((Flags & USE_CATEGORIES)==USE_CATEGORIES) &&
-            (xEvent->Category()->Size()))
-    {
-        cTEXTMapping *text=g->TEXTMappings()->GetMap("category");
-        if (text)
+        case USE_ORIGTITLE:
+            if (xEvent->OrigTitle())
+                description=Add2Description(description,step->label[0],xEvent->OrigTitle());
+            break;
+
+        case USE_CATEGORIES:
         {
             cXMLTVStringList *categories=xEvent->Category();
+            if (!categories->Size()) break;
             // prevent duplicates
             if ((*categories)[0][0]!='G' && (*categories)[0][1]!=' ')
-                description=Add2Description(description,text->Value(),(*categories)[0]);
+                description=Add2Description(description,step->label[0],(*categories)[0]);
             for (int i=1; i<categories->Size(); i++)
             {
                 if (strcasecmp((*categories)[i],(*categories)[i-1]))
                 {
                     if ((*categories)[i][0]!='G' && (*categories)[i][1]!=' ')
-                        description=Add2Description(description,text->Value(),(*categories)[i]);
+                        description=Add2Description(description,step->label[0],(*categories)[i]);
                 }
             }
+            break;
         }
-    }
 
-    if ((what==USE_VIDEO) && ((Flags & USE_VIDEO)==USE_VIDEO) && (xEvent->Video()->Size()))
-    {
-        cTEXTMapping *text=g->TEXTMappings()->GetMap("video");
-        if (text)
+        case USE_VIDEO:
         {
-            description=Add2Description(description,text->Value());
-            description=Add2Description(description,": ");
             cXMLTVStringList *video=xEvent->Video();
+            if (!video->Size()) break;
+            description=Add2Description(description,step->label[0]);
+            description=Add2Description(description,": ");
             for (int i=0; i<video->Size(); i++)
             {
-                char *vtype=strdup((*video)[i]);
-                if (vtype)
-                {
-                    char *vval=strchr(vtype,'|');
-                    if (vval)
-                    {
-                        *vval=0;
-                        vval++;
+                const char *vtype=(*video)[i];
+                const char *vval=strchr(vtype,'|');
+                if (!vval) continue;
+                int tlen=vval-vtype;
+                vval++;
 
-                        if (i)
-                        {
-                            description=Add2Description(description,", ");
-                        }
+                if (i)
+                {
+                    description=Add2Description(description,", ");
+                }
 
-                        if (!strcasecmp(vtype,"colour"))
-                        {
-                            if (!strcasecmp(vval,"no"))
-                            {
-                                cTEXTMapping *text=g->TEXTMappings()->GetMap("blacknwhite");
-                                description=Add2Description(description,text->Value());
-                            }
-                        }
-                        else
-                        {
-                            description=Add2Description(description,vval);
-                        }
+                if ((tlen==6) && !strncasecmp(vtype,"colour",6))
+                {
+                    if (!strcasecmp(vval,"no") && step->label[1])
+                    {
+                        description=Add2Description(description,step->label[1]);
                     }
-                    free(vtype);
+                }
+                else
+                {
+                    description=Add2Description(description,vval);
                 }
             }
             description=Add2Description(description,"\n");
+            break;
         }
-    }
 
-    if ((what==USE_AUDIO) && ((Flags & USE_AUDIO)==USE_AUDIO))
-    {
-        if (xEvent->Audio())
-        {
-            cTEXTMapping *text=g->TEXTMappings()->GetMap("audio");
-            if (text)
+        case USE_AUDIO:
+            if (xEvent->Audio())
             {
-                description=Add2Description(description,text->Value());
-                description=Add2Description(description,": ");
-
                 if ((!strcasecmp(xEvent->Audio(),"mono")) || (!strcasecmp(xEvent->Audio(),"stereo")))
                 {
+                    description=Add2Description(description,step->label[0]);
+                    description=Add2Description(description,": ");
                     description=Add2Description(description,xEvent->Audio());
                     description=Add2Description(description,"\n");
                 }
                 else
                 {
-                    cTEXTMapping *text=g->TEXTMappings()->GetMap(xEvent->Audio());
+                    const char *text=Plan->Label(xEvent->Audio());
+                    description=Add2Description(description,step->label[0]);
+                    description=Add2Description(description,": ");
                     if (text)
                     {
-                        description=Add2Description(description,text->Value());
+                        description=Add2Description(description,text);
                         description=Add2Description(description,"\n");
                     }
                 }
             }
-        }
-    }
-    if ((what==USE_SEASON) && ((Flags & USE_SEASON)==USE_SEASON))
-    {
-        if (xEvent->Season())
-        {
-            cTEXTMapping *text=g->TEXTMappings()->GetMap("season");
-            if (text) description=Add2Description(description,text->Value(),
-                                                      xEvent->Season());
-        }
-
-        if (xEvent->Episode())
-        {
-            cTEXTMapping *text=g->TEXTMappings()->GetMap("episode");
-            if (text) description=Add2Description(description,text->Value(),
-                                                      xEvent->Episode());
-        }
+            break;
 
-        if (xEvent->EpisodeOverall())
-        {
-            cTEXTMapping *text=g->TEXTMappings()->GetMap("episodeoverall");
-            if (text) description=Add2Description(description,text->Value(),
-                                                      xEvent->EpisodeOverall());
-        }
-    }
+        case USE_SEASON:
+            if (xEvent->Season() && step->label[0])
+                description=Add2Description(description,step->label[0],xEvent->Season());
+            if (xEvent->Episode() && step->label[1])
+                description=Add2Description(description,step->label[1],xEvent->Episode());
+            if (xEvent->EpisodeOverall() && step->label[2])
+                description=Add2Description(description,step->label[2],xEvent->EpisodeOverall());
+            break;
 
-    if ((what==USE_RATING) && ((Flags & USE_RATING)==USE_RATING) &&
-            (xEvent->Rating()->Size()))
-    {
-#if VDRVERSNUM < 10711 && !EPGHANDLER
-        Flags|=OPT_RATING_TEXT; // always add to text if we dont have the internal tag!
-#endif
-        if ((Flags & OPT_RATING_TEXT)==OPT_RATING_TEXT)
+        case USE_RATING:
         {
             cXMLTVStringList *rating=xEvent->Rating();
             for (int i=0; i<rating->Size(); i++)
             {
-                char *rtype=strdup((*rating)[i]);
-                if (rtype)
-                {
-                    char *rval=strchr(rtype,'|');
-                    if (rval)
-                    {
-                        *rval=0;
-                        rval++;
-
-                        description=Add2Description(description,rtype);
-                        description=Add2Description(description,": ");
-                        description=Add2Description(description,rval);
-                        description=Add2Description(description,"\n");
-                    }
-                    free(rtype);
-                }
+                const char *rtype=(*rating)[i];
+                const char *rval=strchr(rtype,'|');
+                if (!rval) continue;
+                description=strncatrealloc(description,rtype,rval-rtype);
+                description=Add2Description(description,": ");
+                description=Add2Description(description,rval+1);
+                description=Add2Description(description,"\n");
             }
+            break;
         }
-    }
 
-    if ((what==USE_STARRATING) && ((Flags & USE_STARRATING)==USE_STARRATING) &&
-            (xEvent->StarRating()->Size()))
-    {
-        cTEXTMapping *text=g->TEXTMappings()->GetMap("starrating");
-        if (text)
+        case USE_STARRATING:
         {
-            description=Add2Description(description,text->Value());
-            description=Add2Description(description,": ");
             cXMLTVStringList *starrating=xEvent->StarRating();
+            if (!starrating->Size()) break;
+            description=Add2Description(description,step->label[0]);
+            description=Add2Description(description,": ");
             for (int i=0; i<starrating->Size(); i++)
             {
-                char *rtype=strdup((*starrating)[i]);
-                if (rtype)
-                {
-                    char *rval=strchr(rtype,'|');
-                    if (rval)
-                    {
-                        *rval=0;
-                        rval++;
+                const char *rtype=(*starrating)[i];
+                const char *rval=strchr(rtype,'|');
+                if (!rval) continue;
+                int tlen=rval-rtype;
+                rval++;
 
-                        if (i)
-                        {
-                            description=Add2Description(description,", ");
-                        }
-                        if (strcasecmp(rtype,"*"))
-                        {
-                            description=Add2Description(description,rtype);
-                            description=Add2Description(description," ");
-                        }
-                        description=Add2Description(description,rval);
-                    }
-                    free(rtype);
+                if (i)
+                {
+                    description=Add2Description(description,", ");
+                }
+                if ((tlen!=1) || (*rtype!='*'))
+                {
+                    description=strncatrealloc(description,rtype,tlen);
+                    description=Add2Description(description," ");
                 }
+                description=Add2Description(description,rval);
             }
             description=Add2Description(description,"\n");
+            break;
         }
-    }
 
-    if ((what==USE_REVIEW) && ((Flags & USE_REVIEW)==USE_REVIEW) &&
-            (xEvent->Review()->Size()))
-    {
-        cTEXTMapping *text=g->TEXTMappings()->GetMap("review");
-        if (text)
+        case USE_REVIEW:
         {
             cXMLTVStringList *review=xEvent->Review();
             for (int i=0; i<review->Size(); i++)
             {
-                description=Add2Description(description,text->Value(),(*review)[i]);
+                description=Add2Description(description,step->label[0],(*review)[i]);
             }
+            break;
         }
+        }
+    }
+    return description;
+}
+
+char *cImport::RenderDescription(cXMLTVEvent *xEvent, int Flags)
+{
+    // returns the converted description (to be freed) or NULL
+
+    // the plan contains only the enabled fields in the configured order
+    cEPGMappingsReader maps(g->EPGMappingSnapshots());
+    cRenderPlan tmpplan;
+    const cRenderPlan *plan=maps->RenderPlan(Flags);
+    if (!plan)
+    {
+        maps->BuildRenderPlan(Flags,&tmpplan);
+        plan=&tmpplan;
     }
+    char *description=Render(NULL,plan,xEvent);
+    if (!description) return NULL;
 
+    description=RemoveLastCharFromDescription(description);
+    description=AddEOT2Description(description);
+    const char *dp=conv->Convert(description,false);
+    if (dp!=description)
+    {
+        char *cdp=strdup(dp);
+        free(description);
+        description=cdp;
+    }
     return description;
 }
 
 bool cImport::PutEvent(cEPGSource *Source, sqlite3 *Db, cSchedule* Schedule,
-                       cEvent *Event, cXMLTVEvent *xEvent,int Flags)
+                       cEvent *Event, cXMLTVEvent *xEvent,int Flags, char **Rendered)
 {
     if (!Source) return false;
     if (!Db) return false;
@@ -955,38 +1008,26 @@ bool cImport::PutEvent(cEPGSource *Source, sqlite3 *Db, cSchedule* Schedule,
     }
 
     char *description=NULL;
-
-    const char *ot=g->Order();
-    if (!ot) return false;
-
-    while (*ot)
+    if (Rendered)
+    {
+        // already rendered by a worker
+        description=*Rendered;
+        *Rendered=NULL;
+    }
+    else
     {
-        if (*ot==',') ot++;
-        if (!strncmp(ot,"LOT",3)) description=Add2Description(description,xEvent,Flags,USE_LONGTEXT);
-        if (!strncmp(ot,"CRS",3)) description=Add2Description(description,xEvent,Flags,USE_CREDITS);
-        if (!strncmp(ot,"CAD",3)) description=Add2Description(description,xEvent,Flags,USE_COUNTRYDATE);
-        if (!strncmp(ot,"ORT",3)) description=Add2Description(description,xEvent,Flags,USE_ORIGTITLE);
-        if (!strncmp(ot,"CAT",3)) description=Add2Description(description,xEvent,Flags,USE_CATEGORIES);
-        if (!strncmp(ot,"VID",3)) description=Add2Description(description,xEvent,Flags,USE_VIDEO);
-        if (!strncmp(ot,"AUD",3)) description=Add2Description(description,xEvent,Flags,USE_AUDIO);
-        if (!strncmp(ot,"SEE",3)) description=Add2Description(description,xEvent,Flags,USE_SEASON);
-        if (!strncmp(ot,"RAT",3)) description=Add2Description(description,xEvent,Flags,USE_RATING);
-        if (!strncmp(ot,"STR",3)) description=Add2Description(description,xEvent,Flags,USE_STARRATING);
-        if (!strncmp(ot,"REV",3)) description=Add2Description(description,xEvent,Flags,USE_REVIEW);
-        ot+=3;
+        description=RenderDescription(xEvent,Flags);
     }
 
     if (description)
     {
-        description=RemoveLastCharFromDescription(description);
-        description=AddEOT2Description(description);
-        const char *dp=conv->Convert(description);
-        if (!Event->Description() || strcasecmp(Event->Description(),dp))
+        if (!Event->Description() || strcasecmp(Event->Description(),description))
         {
-            Event->SetDescription(dp);
+            Event->SetDescription(description);
             changed|=CHANGED_DESCRIPTION;
         }
         free(description);
+        description=NULL;
     }
 
 #if VDRVERSNUM >= 10711 || EPGHANDLER
@@ -1000,58 +1041,37 @@ bool cImport::PutEvent(cEPGSource *Source, sqlite3 *Db, cSchedule* Schedule,
 #endif
 
 #if VDRVERSNUM >= 10712 || EPGHANDLER
-    if ((Flags & USE_CONTENT)==USE_CONTENT)
+    if (((Flags & USE_CONTENT)==USE_CONTENT) && xEvent->NumContents())
     {
+        // content codes are already parsed (see cXMLTVEvent::AddCategory)
         uchar contents[MaxEventContents];
+        int num=0;
         for (int i=0; i<MaxEventContents; i++)
         {
             contents[i]=Event->Contents(i);
+            if (contents[i]) num=i+1;
         }
-        cXMLTVStringList *categories=xEvent->Category();
-        for (int i=0; i<categories->Size(); i++)
+        if (!num)
         {
-            char *tok,*sp;
-            char delim[]=",";
-            if ((*categories)[i][0]=='G' && (*categories)[i][1]==' ')
+            for (int i=0; i<MaxEventContents; i++)
             {
-                char *val=strdup(&(*categories)[i][2]);
-                if (val)
+                contents[i]=(i<xEvent->NumContents()) ? xEvent->Contents()[i] : 0;
+            }
+            Event->SetContents(contents);
+        }
+        else
+        {
+            bool add=false;
+            for (int i=0; i<xEvent->NumContents() && num<MaxEventContents; i++)
+            {
+                uchar uval=xEvent->Contents()[i];
+                if (!memchr(contents,uval,num))
                 {
-                    tok=strtok_r(val,delim,&sp);
-                    while (tok)
-                    {
-                        unsigned int hval;
-                        if (sscanf(tok,"%2x",&hval)==1)
-                        {
-                            uchar uval=(uchar) hval;
-                            bool found=false;
-                            for (int i=0; i<MaxEventContents; i++)
-                            {
-                                if (contents[i]==uval)
-                                {
-                                    found=true;
-                                    break;
-                                }
-                            }
-                            if (!found)
-                            {
-                                for (int i=0; i<MaxEventContents; i++)
-                                {
-                                    if (!contents[i])
-                                    {
-                                        contents[i]=uval;
-                                        break;
-                                    }
-                                }
-                            }
-
-                        }
-                        tok=strtok_r(NULL,delim,&sp);
-                    }
+                    contents[num++]=uval;
+                    add=true;
                 }
-                free(val);
-                Event->SetContents(contents);
             }
+            if (add) Event->SetContents(contents);
         }
     }
 #endif
@@ -1100,114 +1120,211 @@ bool cImport::PutEvent(cEPGSource *Source, sqlite3 *Db, cSchedule* Schedule,
     return retcode;
 }
 
-bool cImport::FetchXMLTVEvent(sqlite3_stmt *stmt, cXMLTVEvent *xevent)
+// same order as the COL_ enum in import.h
+static const struct
 {
-    if (!stmt) return false;
-    if (!xevent) return false;
-    xevent->Clear();
+    const char *name;
+    int flags;  // column is needed if one of these flags is set, 0 = always
+    bool heavy; // large text, only fetched after a match
+} xmltvcolumns[]=
+{
+    { "channelid",      0,                             false },
+    { "eventid",        0,                             false },
+    { "starttime",      0,                             false },
+    { "duration",       0,                             false },
+    { "title",          0,                             false },
+    { "origtitle",      USE_ORIGTITLE,                 false },
+    { "shorttext",      USE_SHORTTEXT|OPT_APPEND,      false },
+    { "description",    USE_LONGTEXT|OPT_APPEND,       true  },
+    { "country",        USE_COUNTRYDATE,               false },
+    { "year",           USE_COUNTRYDATE,               false },
+    { "credits",        USE_CREDITS,                   true  },
+    { "category",       USE_CATEGORIES,                false },
+    { "review",         USE_REVIEW,                    true  },
+    { "rating",         USE_RATING,                    false },
+    { "starrating",     USE_STARRATING,                false },
+    { "video",          USE_VIDEO,                     false },
+    { "audio",          USE_AUDIO,                     false },
+    { "season",         USE_SEASON,                    false },
+    { "episode",        USE_SEASON,                    false },
+    { "episodeoverall", USE_SEASON,                    false },
+    { "pics",           0,                             false },
+    { "src",            0,                             false },
+    { "eiteventid",     0,                             false },
+    { "eitdescription", 0,                             true  },
+    { "alttitle",       OPT_SEASON_STEXTITLE,          false },
+    { "contents",       USE_CONTENT,                   false }
+};
+
+char *cImport::SQLColumns(int Flags)
+{
+    char *columns=NULL;
+    for (int i=0; i<COL_MAX; i++)
+    {
+        if (xmltvcolumns[i].flags && ((Flags & xmltvcolumns[i].flags)==0)) continue;
+        if (columns) columns=strcatrealloc(columns,",");
+        columns=strcatrealloc(columns,xmltvcolumns[i].name);
+    }
+    return columns;
+}
+
+void cImport::MapColumns(sqlite3_stmt *stmt, int *Cols)
+{
+    for (int i=0; i<COL_MAX; i++) Cols[i]=-1;
+    if (!stmt) return;
     int cols=sqlite3_column_count(stmt);
     for (int col=0; col<cols; col++)
     {
-        switch (col)
+        const char *name=sqlite3_column_name(stmt,col);
+        if (!name) continue;
+        for (int i=0; i<COL_MAX; i++)
         {
-        case 0:
-            xevent->SetChannelID((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 1:
-            xevent->SetEventID(sqlite3_column_int(stmt,col));
-            break;
-        case 2:
-            xevent->SetStartTime(sqlite3_column_int(stmt,col));
-            break;
-        case 3:
-            xevent->SetDuration(sqlite3_column_int(stmt,col));
-            break;
-        case 4:
-            xevent->SetTitle((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 5:
-            xevent->SetOrigTitle((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 6:
-            xevent->SetShortText((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 7:
-            xevent->SetDescription((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 8:
-            xevent->SetCountry((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 9:
-            xevent->SetYear(sqlite3_column_int(stmt,col));
-            break;
-        case 10:
-            xevent->SetCredits((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 11:
-            xevent->SetCategory((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 12:
-            xevent->SetReview((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 13:
-            xevent->SetRating((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 14:
-            xevent->SetStarRating((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 15:
-            xevent->SetVideo((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 16:
-            xevent->SetAudio((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 17:
-            xevent->SetSeason(sqlite3_column_int(stmt,col));
-            break;
-        case 18:
-            xevent->SetEpisode(sqlite3_column_int(stmt,col));
-            break;
-        case 19:
-            xevent->SetEpisodeOverall(sqlite3_column_int(stmt,col));
-            break;
-        case 20:
-            xevent->SetPics((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 21:
-            xevent->SetSource((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 22:
-            xevent->SetEITEventID(sqlite3_column_int(stmt,col));
-            break;
-        case 23:
-            xevent->SetEITDescription((const char *) sqlite3_column_text(stmt,col));
-            break;
-        case 24:
-            xevent->SetAltTitle((const char *) sqlite3_column_text(stmt,col));
-            break;
+            if (!strcmp(name,xmltvcolumns[i].name))
+            {
+                Cols[i]=col;
+                break;
+            }
         }
     }
+}
+
+bool cImport::FetchXMLTVEvent(sqlite3_stmt *stmt, const int *Cols, int Flags, cXMLTVEvent *xevent,
+                              bool Heavy)
+{
+    // fast path for rows from epg.db: the values were sanitized before
+    // they were written, so we just copy the columns PutEvent will use
+    // with the given Flags. The xevent should be reused for every row,
+    // strcpyrealloc keeps the buffers and saves us the allocations.
+    // Large text columns are only copied if Heavy is set, the caller
+    // can fetch them later with FetchHeavyColumns (on the same row!)
+    if (!stmt) return false;
+    if (!Cols) return false;
+    if (!xevent) return false;
+
+#define COLTEXT(c) ((Cols[c]>=0) ? (const char *) sqlite3_column_text(stmt,Cols[c]) : NULL)
+#define COLINT(c) ((Cols[c]>=0) ? sqlite3_column_int(stmt,Cols[c]) : 0)
+#define WANTED(f) ((Flags & (f))!=0)
+
+    xevent->SetTrusted(true);
+    xevent->ClearLists();
+
+    xevent->SetChannelID(COLTEXT(COL_CHANNELID));
+    xevent->SetSource(COLTEXT(COL_SRC));
+    xevent->SetEventID(COLINT(COL_EVENTID));
+    xevent->SetEITEventID(COLINT(COL_EITEVENTID));
+    xevent->SetStartTime(COLINT(COL_STARTTIME));
+    xevent->SetDuration(COLINT(COL_DURATION));
+    xevent->SetTitle(COLTEXT(COL_TITLE));
+    xevent->SetPics(COLTEXT(COL_PICS));
+
+    xevent->SetAltTitle(WANTED(OPT_SEASON_STEXTITLE) ? COLTEXT(COL_ALTTITLE) : NULL);
+    xevent->SetShortText(WANTED(USE_SHORTTEXT|OPT_APPEND) ? COLTEXT(COL_SHORTTEXT) : NULL);
+    xevent->SetOrigTitle(WANTED(USE_ORIGTITLE) ? COLTEXT(COL_ORIGTITLE) : NULL);
+    xevent->SetAudio(WANTED(USE_AUDIO) ? COLTEXT(COL_AUDIO) : NULL);
+
+    if (WANTED(USE_COUNTRYDATE))
+    {
+        xevent->SetCountry(COLTEXT(COL_COUNTRY));
+        xevent->SetYear(COLINT(COL_YEAR));
+    }
+    else
+    {
+        xevent->SetCountry(NULL);
+        xevent->SetYear(0);
+    }
+
+    if (WANTED(USE_SEASON))
+    {
+        xevent->SetSeason(COLINT(COL_SEASON));
+        xevent->SetEpisode(COLINT(COL_EPISODE));
+        xevent->SetEpisodeOverall(COLINT(COL_EPISODEOVERALL));
+    }
+    else
+    {
+        xevent->SetSeason(0);
+        xevent->SetEpisode(0);
+        xevent->SetEpisodeOverall(0);
+    }
+
+    if (WANTED(USE_CATEGORIES)) xevent->SetCategory(COLTEXT(COL_CATEGORY));
+    if (WANTED(USE_CONTENT) && (Cols[COL_CONTENTS]>=0))
+    {
+        xevent->SetContents(sqlite3_column_blob(stmt,Cols[COL_CONTENTS]),
+                            sqlite3_column_bytes(stmt,Cols[COL_CONTENTS]));
+    }
+    if (WANTED(USE_RATING)) xevent->SetRating(COLTEXT(COL_RATING));
+    if (WANTED(USE_STARRATING)) xevent->SetStarRating(COLTEXT(COL_STARRATING));
+    if (WANTED(USE_VIDEO)) xevent->SetVideo(COLTEXT(COL_VIDEO));
+
+#undef COLTEXT
+#undef COLINT
+#undef WANTED
+    // later changes (e.g. the eit text) must be sanitized again
+    xevent->SetTrusted(false);
+    if (Heavy) FetchHeavyColumns(stmt,Cols,Flags,xevent);
     return true;
 }
 
-cXMLTVEvent *cImport::PrepareAndReturn(sqlite3 **db, char *sql)
+void cImport::FetchHeavyColumns(sqlite3_stmt *stmt, const int *Cols, int Flags, cXMLTVEvent *xevent)
 {
-    if (!db) return NULL;
-    if (!*db) return NULL;
-    if (!sql) return NULL;
+    // sqlite only reads the overflow pages of a row if the column is accessed
+#define COLTEXT(c) ((Cols[c]>=0) ? (const char *) sqlite3_column_text(stmt,Cols[c]) : NULL)
+#define WANTED(f) ((Flags & (f))!=0)
+    xevent->SetTrusted(true);
+    xevent->SetEITDescription(COLTEXT(COL_EITDESCRIPTION));
+    xevent->SetDescription(WANTED(USE_LONGTEXT|OPT_APPEND) ? COLTEXT(COL_DESCRIPTION) : NULL);
+    xevent->Credits()->Clear();
+    if (WANTED(USE_CREDITS)) xevent->SetCredits(COLTEXT(COL_CREDITS));
+    xevent->Review()->Clear();
+    if (WANTED(USE_REVIEW)) xevent->SetReview(COLTEXT(COL_REVIEW));
+    xevent->SetTrusted(false);
+#undef COLTEXT
+#undef WANTED
+}
+
+struct cImport::searchstmt *cImport::SearchStatement(sqlite3 **Db, int Kind, int Flags)
+{
+    // the statements of SearchXMLTVEvent only differ in the columns (Flags)
+    // and the title condition, so they are prepared once and reused.
+    // A row with the eit eventid is ranked before a row with the title
+    for (int i=0; i<IMPORT_SEARCHSTMTS; i++)
+    {
+        struct searchstmt *search=&searchstmts[i];
+        if (search->stmt && (search->db==*Db) && (search->kind==Kind) && (search->flags==Flags))
+            return search;
+    }
+
+    char *columns=SQLColumns(Flags);
+    if (!columns)
+    {
+        esyslog("out of memory");
+        return NULL;
+    }
+    const char *cond=(Kind==SEARCH_SOUNDEX) ? "soundex(title)=?6" : "title=?6";
+    char *sql;
+    if (asprintf(&sql,"select %s,abs(starttime-?1) as diff from epg where " \
+                 " (starttime>=?2 and starttime<=?3) and (eiteventid=?4 or %s) and channelid=?5 " \
+                 " order by coalesce(eiteventid=?4,0) desc,diff,srcidx asc limit 1;",columns,cond)==-1)
+    {
+        free(columns);
+        esyslog("out of memory");
+        return NULL;
+    }
+    free(columns);
 
     sqlite3_stmt *stmt=NULL;
-    int ret=sqlite3_prepare_v2(*db,sql,strlen(sql),&stmt,NULL);
+    int ret=sqlite3_prepare_v2(*Db,sql,-1,&stmt,NULL);
     if (ret!=SQLITE_OK)
     {
-        const char *errmsg=sqlite3_errmsg(*db);
+        const char *errmsg=sqlite3_errmsg(*Db);
         if (errmsg)
         {
             if (strstr(errmsg,"no such column"))
             {
                 esyslog("sqlite3: database schema changed, unlinking epg.db!");
-                sqlite3_close(*db);
-                *db=NULL;
+                FinalizeStatements();
+                sqlite3_close(*Db);
+                *Db=NULL;
                 unlink(g->EPGFile());
             }
             else
@@ -1219,18 +1336,48 @@ cXMLTVEvent *cImport::PrepareAndReturn(sqlite3 **db, char *sql)
         free(sql);
         return NULL;
     }
+    free(sql);
 
+    struct searchstmt *search=&searchstmts[nextsearchstmt];
+    nextsearchstmt=(nextsearchstmt+1) % IMPORT_SEARCHSTMTS;
+    if (search->stmt) sqlite3_finalize(search->stmt);
+    search->db=*Db;
+    search->kind=Kind;
+    search->flags=Flags;
+    search->stmt=stmt;
+    MapColumns(stmt,search->cols);
+    return search;
+}
+
+cXMLTVEvent *cImport::StepAndReturn(struct searchstmt *Search, int Flags, cXMLTVEvent *Result)
+{
+    // the row is copied into Result (or a new event), the buffers of a
+    // reused Result are kept. The statement is reset afterwards, so it
+    // holds no read lock on epg.db
     cXMLTVEvent *xevent=NULL;
-    if (sqlite3_step(stmt)==SQLITE_ROW)
+    AddDB(DBOP_SELECT);
+    if (sqlite3_step(Search->stmt)==SQLITE_ROW)
     {
-        xevent = new cXMLTVEvent();
-        FetchXMLTVEvent(stmt,xevent);
+        xevent=Result ? Result : new cXMLTVEvent();
+        FetchXMLTVEvent(Search->stmt,Search->cols,Flags,xevent,true);
     }
-    sqlite3_finalize(stmt);
-    free(sql);
+    sqlite3_reset(Search->stmt);
+    sqlite3_clear_bindings(Search->stmt);
     return xevent;
 }
 
+void cImport::FinalizeStatements()
+{
+    // must be called before the database is closed
+    for (int i=0; i<IMPORT_SEARCHSTMTS; i++)
+    {
+        if (searchstmts[i].stmt) sqlite3_finalize(searchstmts[i].stmt);
+        searchstmts[i].stmt=NULL;
+        searchstmts[i].db=NULL;
+    }
+    nextsearchstmt=0;
+}
+
 void cImport::AddShortTextFromEITDescription(cXMLTVEvent *xEvent, const char *EITDescription)
 {
     if (!g->EPDir()) return;
@@ -1328,12 +1475,14 @@ cXMLTVEvent *cImport::AddXMLTVEvent(cEPGSource *Source,sqlite3 *Db, const char *
     if (isql && usql)
     {
         char *errmsg;
+        AddDB(DBOP_WRITE);
         int ret=sqlite3_exec(Db,isql,NULL,NULL,&errmsg);
         if (ret!=SQLITE_OK)
         {
             if (ret==SQLITE_CONSTRAINT)
             {
                 sqlite3_free(errmsg);
+                AddDB(DBOP_WRITE);
                 ret=sqlite3_exec(Db,usql,NULL,NULL,&errmsg);
             }
             if (ret!=SQLITE_OK)
@@ -1346,6 +1495,8 @@ cXMLTVEvent *cImport::AddXMLTVEvent(cEPGSource *Source,sqlite3 *Db, const char *
         }
         if (ret==SQLITE_OK)
         {
+            // no DBChanged(): the eit row only matches this event, which
+            // changes (and leaves the handler cache) with PutEvent
             tsyslogs(Source,"{%5i} adding '%s'/'%s' to db",xevent->EventID(),
                      xevent->Title(),xevent->ShortText());
         }
@@ -1436,6 +1587,7 @@ bool cImport::UpdateXMLTVEvent(cEPGSource *Source, sqlite3 *Db, const cEvent *Ev
     }
 
     char *errmsg;
+    AddDB(DBOP_WRITE);
     if (sqlite3_exec(Db,sql,NULL,NULL,&errmsg)!=SQLITE_OK)
     {
         esyslogs(Source,"%s -> %s",sql,errmsg);
@@ -1448,109 +1600,169 @@ bool cImport::UpdateXMLTVEvent(cEPGSource *Source, sqlite3 *Db, const cEvent *Ev
     return true;
 }
 
-cXMLTVEvent *cImport::SearchXMLTVEvent(sqlite3 **Db,const char *ChannelID, const cEvent *Event)
+cXMLTVEvent *cImport::SearchXMLTVEvent(sqlite3 **Db,const char *ChannelID, const cEvent *Event, int Flags,
+                                       cXMLTVEvent *Result)
 {
+    // if Result is given, the found event is stored there and Result is
+    // returned, otherwise a new event is returned (to be deleted)
     if (!Event) return NULL;
     if (!Db) return NULL;
     if (!*Db)
     {
         // we need READWRITE because the epg.db maybe updated later
+        AddDB(DBOP_OPEN);
         if (sqlite3_open_v2(g->EPGFile(),Db,SQLITE_OPEN_READWRITE,NULL)!=SQLITE_OK)
         {
             esyslog("failed to open %s",g->EPGFile());
             *Db=NULL;
             return NULL;
         }
+        openinode=dbinode;
+        g->TimeOffsets()->Load(*Db);
     }
 
-    cXMLTVEvent *xevent=NULL;
-    char *sql=NULL;
+    // xmltv starttime = eit starttime - learned offset
+    time_t start=Event->StartTime()-g->TimeOffsets()->Offset(Event->ChannelID());
 
     int eventTimeDiff=0;
     if (Event->Duration()) eventTimeDiff=Event->Duration()/4;
     if (eventTimeDiff<100) eventTimeDiff=100;
     if (eventTimeDiff>720) eventTimeDiff=720;
 
-    if (asprintf(&sql,"select channelid,eventid,starttime,duration,title,origtitle,shorttext,description," \
-                 "country,year,credits,category,review,rating,starrating,video,audio,season,episode," \
-                 "episodeoverall,pics,src,eiteventid,eitdescription,alttitle,abs(starttime-%li) as diff from epg where " \
-                 " (starttime>=%li and starttime<=%li) and eiteventid=%u and channelid='%s' " \
-                 " order by diff,srcidx asc limit 1;",Event->StartTime(),Event->StartTime()-eventTimeDiff,
-                 Event->StartTime()+eventTimeDiff,Event->EventID(),ChannelID)==-1)
+    // one query for the eit eventid and the (soundex) title
+    struct searchstmt *search;
+    char wstr[128];
+    if (g->SoundEx() && Event->Title() && (SoundEx((char *) &wstr,(char *) Event->Title(),0,1)!=0))
     {
-        esyslog("out of memory");
-        return NULL;
+        search=SearchStatement(Db,SEARCH_SOUNDEX,Flags);
+        if (!search) return NULL;
+        sqlite3_bind_text(search->stmt,6,wstr,-1,SQLITE_STATIC);
     }
+    else
+    {
+        search=SearchStatement(Db,SEARCH_TITLE,Flags);
+        if (!search) return NULL;
+        if (Event->Title()) sqlite3_bind_text(search->stmt,6,Event->Title(),-1,SQLITE_STATIC);
+    }
+    sqlite3_bind_int64(search->stmt,1,start);
+    sqlite3_bind_int64(search->stmt,2,start-eventTimeDiff);
+    sqlite3_bind_int64(search->stmt,3,start+eventTimeDiff);
+    sqlite3_bind_int64(search->stmt,4,Event->EventID());
+    sqlite3_bind_text(search->stmt,5,ChannelID,-1,SQLITE_STATIC);
+    return StepAndReturn(search,Flags,Result);
+}
 
-    xevent=PrepareAndReturn(Db,sql);
-    if (xevent) return xevent;
-
-    bool bUseRawTitle=false;
-    if (g->SoundEx())
+int cImport::SearchXMLTVEvents(sqlite3 **Db, const char *ChannelID, cEvent * const *Events,
+                               cXMLTVEvent **Results, int Count, int Flags)
+{
+    // batched SearchXMLTVEvent for events of the same channel: the keys go
+    // into a temp table and all events are resolved with one query. The
+    // ranking is the same (eiteventid match first, then title/soundex).
+    // Returns the number of found events or -1 on error.
+    if (!Db || !ChannelID || !Events || !Results) return -1;
+    for (int i=0; i<Count; i++) Results[i]=NULL;
+    if (!Count) return 0;
+    if (!*Db)
     {
-        char wstr[128];
-        if (SoundEx((char *) &wstr,(char *) Event->Title(),0,1)==0)
+        // we need READWRITE because the epg.db maybe updated later
+        AddDB(DBOP_OPEN);
+        if (sqlite3_open_v2(g->EPGFile(),Db,SQLITE_OPEN_READWRITE,NULL)!=SQLITE_OK)
         {
-            bUseRawTitle=true;
+            esyslog("failed to open %s",g->EPGFile());
+            *Db=NULL;
+            return -1;
         }
-        else
-        {
+        g->TimeOffsets()->Load(*Db);
+    }
+    int offset=g->TimeOffsets()->Offset(Events[0]->ChannelID());
 
-            if (asprintf(&sql,"select channelid,eventid,starttime,duration,title,origtitle,shorttext,description," \
-                         "country,year,credits,category,review,rating,starrating,video,audio,season,episode," \
-                         "episodeoverall,pics,src,eiteventid,eitdescription,alttitle,abs(starttime-%li) as diff from epg where " \
-                         " (starttime>=%li and starttime<=%li) and soundex(title)='%s' and channelid='%s' " \
-                         " order by diff,srcidx asc limit 1;",Event->StartTime(),Event->StartTime()-eventTimeDiff,
-                         Event->StartTime()+eventTimeDiff,wstr,ChannelID)==-1)
-            {
-                esyslog("out of memory");
-                return NULL;
-            }
-        }
+    if (sqlite3_exec(*Db,"CREATE TEMP TABLE IF NOT EXISTS timerkeys (tk int, teid int, tstart int, " \
+                     "twin int, ttitle text, tsx text); DELETE FROM timerkeys;",NULL,NULL,NULL)!=SQLITE_OK)
+    {
+        esyslog("sqlite3: %s (timerkeys)",sqlite3_errmsg(*Db));
+        return -1;
     }
-    else
+
+    sqlite3_stmt *stmt=NULL;
+    if (sqlite3_prepare_v2(*Db,"INSERT INTO timerkeys VALUES (?,?,?,?,?,?);",-1,&stmt,NULL)!=SQLITE_OK)
     {
-        bUseRawTitle=true;
+        esyslog("sqlite3: %s (timerkeys)",sqlite3_errmsg(*Db));
+        return -1;
     }
-    
-    if (bUseRawTitle)
+    for (int i=0; i<Count; i++)
     {
-        char *sqltitle=strdup(Event->Title());
-        if (!sqltitle)
+        const cEvent *Event=Events[i];
+        int eventTimeDiff=0;
+        if (Event->Duration()) eventTimeDiff=Event->Duration()/4;
+        if (eventTimeDiff<100) eventTimeDiff=100;
+        if (eventTimeDiff>720) eventTimeDiff=720;
+
+        sqlite3_bind_int(stmt,1,i);
+        sqlite3_bind_int64(stmt,2,Event->EventID());
+        sqlite3_bind_int64(stmt,3,Event->StartTime()-offset);
+        sqlite3_bind_int(stmt,4,eventTimeDiff);
+        sqlite3_bind_text(stmt,5,Event->Title(),-1,SQLITE_STATIC);
+        char wstr[128];
+        if (g->SoundEx() && Event->Title() && (SoundEx((char *) &wstr,(char *) Event->Title(),0,1)!=0))
         {
-            esyslog("out of memory");
-            return NULL;
+            sqlite3_bind_text(stmt,6,wstr,-1,SQLITE_TRANSIENT);
         }
-
-        string st=sqltitle;
-
-        int reps;
-        reps=pcrecpp::RE("'").GlobalReplace("''",&st);
-        if (reps)
+        else
         {
-            char *tmp_sqltitle=(char *) realloc(sqltitle,st.size()+1);
-            if (tmp_sqltitle)
-            {
-                sqltitle=tmp_sqltitle;
-                strcpy(sqltitle,st.c_str());
-            }
+            sqlite3_bind_null(stmt,6);
         }
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
 
-        if (asprintf(&sql,"select channelid,eventid,starttime,duration,title,origtitle,shorttext,description," \
-                     "country,year,credits,category,review,rating,starrating,video,audio,season,episode," \
-                     "episodeoverall,pics,src,eiteventid,eitdescription,abs(starttime-%li) as diff from epg where " \
-                     " (starttime>=%li and starttime<=%li) and title='%s' and channelid='%s' " \
-                     " order by diff,srcidx asc limit 1;",Event->StartTime(),Event->StartTime()-eventTimeDiff,
-                     Event->StartTime()+eventTimeDiff,sqltitle,ChannelID)==-1)
-        {
-            free(sqltitle);
-            esyslog("out of memory");
-            return NULL;
-        }
-        free(sqltitle);
+    char *columns=SQLColumns(Flags);
+    if (!columns)
+    {
+        esyslog("out of memory");
+        return -1;
+    }
+    char *sql=NULL;
+    if (asprintf(&sql,"select t.tk,%s,abs(starttime-t.tstart) as diff from timerkeys t, epg where " \
+                 " channelid=? and starttime>=t.tstart-t.twin and starttime<=t.tstart+t.twin and " \
+                 " (eiteventid=t.teid or (t.tsx is null and title=t.ttitle)%s) " \
+                 " order by t.tk,(eiteventid=t.teid) desc,diff,srcidx asc;",columns,
+                 g->SoundEx() ? " or (t.tsx is not null and soundex(title)=t.tsx)" : "")==-1)
+    {
+        free(columns);
+        esyslog("out of memory");
+        return -1;
+    }
+    free(columns);
+
+    stmt=NULL;
+    AddDB(DBOP_SELECT);
+    if (sqlite3_prepare_v2(*Db,sql,-1,&stmt,NULL)!=SQLITE_OK)
+    {
+        // the caller falls back to SearchXMLTVEvent, which handles schema changes
+        tsyslog("sqlite3: %s (%s)",sqlite3_errmsg(*Db),sql);
+        free(sql);
+        return -1;
     }
+    free(sql);
+    sqlite3_bind_text(stmt,1,ChannelID,-1,SQLITE_STATIC);
 
-    return PrepareAndReturn(Db,sql);
+    int cols[COL_MAX];
+    MapColumns(stmt,cols);
+    int found=0;
+    while (sqlite3_step(stmt)==SQLITE_ROW)
+    {
+        // rows are ordered by key, the first row of a key is the best match
+        int k=sqlite3_column_int(stmt,0);
+        if ((k<0) || (k>=Count) || Results[k]) continue;
+        cXMLTVEvent *xevent=new cXMLTVEvent();
+        if (!xevent) break;
+        FetchXMLTVEvent(stmt,cols,Flags,xevent,true);
+        Results[k]=xevent;
+        found++;
+    }
+    sqlite3_finalize(stmt);
+    return found;
 }
 
 bool cImport::Begin(cEPGSource *Source, sqlite3 *Db)
@@ -1560,6 +1772,7 @@ bool cImport::Begin(cEPGSource *Source, sqlite3 *Db)
     if (!pendingtransaction)
     {
         char *errmsg;
+        AddDB(DBOP_TRANSACTION);
         if (sqlite3_exec(Db,"BEGIN",NULL,NULL,&errmsg)!=SQLITE_OK)
         {
             esyslogs(Source,"sqlite3: BEGIN -> %s",errmsg);
@@ -1580,6 +1793,7 @@ bool cImport::Commit(cEPGSource *Source, sqlite3 *Db)
     if (pendingtransaction)
     {
         char *errmsg;
+        AddDB(DBOP_TRANSACTION);
         if (sqlite3_exec(Db,"COMMIT",NULL,NULL,&errmsg)!=SQLITE_OK)
         {
             if (Source)
@@ -1598,6 +1812,93 @@ bool cImport::Commit(cEPGSource *Source, sqlite3 *Db)
     return true;
 }
 
+void cImport::MatchJobs(cEPGSource *Source, cImportBatch *Batch)
+{
+    // runs in the worker threads (and in the import thread): the import
+    // thread holds the schedules lock and doesn't change the schedules
+    // until all jobs are done, so we only read them here
+    cImportJob *job;
+    while ((job=Batch->Next())!=NULL)
+    {
+        schedindex.Build(job->Schedule());
+        int hint=job->Offset();
+        for (int i=0; i<job->Count(); i++)
+        {
+            cXMLTVEvent *xevent=job->XEvent(i);
+            cEvent *event=SearchVDREvent(Source,job->Schedule(),xevent,false,hint,job->Offset(),
+                                         schedindex.Valid() ? &schedindex : NULL);
+            if (!event)
+            {
+                hint=job->Offset();
+                continue;
+            }
+            g->TimeOffsets()->Add(job->ChannelID(),(int) (event->StartTime()-xevent->StartTime()));
+            hint=(int)(event->StartTime()+event->Duration())-(int)(xevent->StartTime()+xevent->Duration());
+
+            // same eitdescription as PutEvent/UpdateXMLTVEvent will use
+            bool waschanged=WasChanged(event);
+            if (waschanged)
+            {
+                if (!xevent->EITDescription())
+                {
+                    job->SetResult(i,event,waschanged,NULL);
+                    continue; // PutEvent will not use it
+                }
+            }
+            else
+            {
+                if (event->Description()) xevent->SetEITDescription(event->Description());
+            }
+            job->SetResult(i,event,waschanged,RenderDescription(xevent,job->Flags()));
+        }
+    }
+    schedindex.Clear();
+}
+
+int cImport::RunBatch(cEPGSource *Source, sqlite3 *Db, const cSchedules *Schedules, cImportBatch *Batch,
+                      cImportWorker **Workers, int Threads, time_t Begin)
+{
+    if (!Batch->Count()) return 0;
+#if VDRVERSNUM < 10726 && (!EPGHANDLER)
+    time_t endoneday=Begin+86400;
+#endif
+
+    // match and render in parallel, we are one of the workers
+    Batch->Start(Threads);
+    for (int i=0; i<Threads-1; i++)
+    {
+        if (!Workers[i]->Run(Source,Batch)) Batch->Done();
+    }
+    MatchJobs(Source,Batch);
+    Batch->Done();
+    Batch->Wait();
+
+    // apply the results in the order of the channels
+    int cnt=0;
+    for (cImportJob *job=Batch->First(); job; job=Batch->cList<cImportJob>::Next(job))
+    {
+        for (int i=0; i<job->Count(); i++)
+        {
+            cEvent *event=job->Event(i);
+            if (!event) continue;
+            cXMLTVEvent *xevent=job->XEvent(i);
+#if VDRVERSNUM < 10726 && (!EPGHANDLER)
+            if (xevent->StartTime()>endoneday) continue;
+#endif
+            // an event matched twice is already changed -> render it again
+            char **rendered=NULL;
+            if (job->WasChanged(i)==WasChanged(event)) rendered=job->Description(i);
+            if (PutEvent(Source,Db,job->Schedule(),event,xevent,job->Flags(),rendered))
+            {
+                Schedules->SetModified(job->Schedule());
+                cnt++;
+            }
+        }
+    }
+    Batch->Clear();
+    return cnt;
+}
+
 int cImport::Process(cEPGSource *Source, cEPGExecutor &myExecutor)
 {
     if (!Source) return 0;
@@ -1628,6 +1929,7 @@ int cImport::Process(cEPGSource *Source, cEPGExecutor &myExecutor)
         if (schedules) break;
         l++;
     }
+    cStatTimer locktime;
 
     dsyslogs(Source,"importing from db");
     sqlite3 *db=NULL;
@@ -1639,13 +1941,18 @@ int cImport::Process(cEPGSource *Source, cEPGExecutor &myExecutor)
         return 141;
     }
 
+    g->TimeOffsets()->Load(db);
+
+    // select only the columns which are used by at least one mapping
+    cEPGMappingsReader maps(g->EPGMappingSnapshots());
+    char *columns=SQLColumns(maps->AllFlags());
+
     char *sql;
-    if (asprintf(&sql,"select channelid,eventid,starttime,duration,title,origtitle,shorttext,description," \
-                 "country,year,credits,category,review,rating,starrating,video,audio,season,episode,episodeoverall," \
-                 "pics,src,eiteventid,eitdescription from epg where (starttime > %li or " \
+    if (!columns || asprintf(&sql,"select %s from epg where (starttime > %li or " \
                  " (starttime + duration) > %li) and (starttime + duration) < %li "\
-                 " and src='%s' order by channelid,starttime;",begin,begin,end,Source->Name())==-1)
+                 " and src='%s' order by channelid,starttime;",columns,begin,begin,end,Source->Name())==-1)
     {
+        if (columns) free(columns);
         sqlite3_close(db);
         esyslogs(Source,"out of memory");
         delete schedulesLock;
@@ -1660,118 +1967,193 @@ int cImport::Process(cEPGSource *Source, cEPGExecutor &myExecutor)
         esyslogs(Source,"%i %s (p)",ret,sqlite3_errmsg(db));
         sqlite3_close(db);
         free(sql);
+        free(columns);
         delete schedulesLock;
         Timers.DecBeingEdited();
         return 141;
     }
     free(sql);
+    free(columns);
+
+    int cols[COL_MAX];
+    MapColumns(stmt,cols);
 
     int lerr=0;
     int cnt=0;
     char *lastChannelID=NULL;
-    int flags=0,hint=0;
+    int flags=0,hint=0,offset=0;
+    tChannelID chanid;
     bool addevents=false;
     cSchedule* schedule=NULL;
-    for (;;)
+    cXMLTVEvent xevent;
+
+    // with more than one thread, channels without the append option are
+    // matched in parallel and the results are applied in batches
+    int threads=g->ImportThreads();
+    cImportBatch *batch=NULL;
+    cImportWorker **workers=NULL;
+    cImportJob *job=NULL;
+    if (threads>1)
     {
-        if (sqlite3_step(stmt)==SQLITE_ROW)
+        batch=new cImportBatch();
+        workers=(cImportWorker **) malloc((threads-1)*sizeof(cImportWorker *));
+        if (workers)
         {
-            cXMLTVEvent xevent;
-            if (FetchXMLTVEvent(stmt,&xevent))
-            {
-                if (!lastChannelID || strcmp(lastChannelID,xevent.ChannelID()))
-                {
-                    cEPGMapping *map=g->EPGMappings()->GetMap(tChannelID::FromString(xevent.ChannelID()));
-                    if (!map)
-                    {
-                        if (lerr!=IMPORT_NOMAPPING)
-                            esyslogs(Source,"no mapping for channelid %s",xevent.ChannelID());
-                        lerr=IMPORT_NOMAPPING;
-                        if (lastChannelID)
-                        {
-                            free(lastChannelID);
-                            lastChannelID=NULL;
-                        }
-                        continue;
-                    }
-                    flags=map->Flags();
+            for (int i=0; i<threads-1; i++) workers[i]=new cImportWorker(g);
+        }
+        else
+        {
+            delete batch;
+            batch=NULL;
+        }
+    }
 
-                    bool addevents=false;
-                    if ((flags & OPT_APPEND)==OPT_APPEND) addevents=true;
+    for (;;)
+    {
+        if (sqlite3_step(stmt)!=SQLITE_ROW) break;
 
-                    cChannel *channel=Channels.GetByChannelID(tChannelID::FromString(xevent.ChannelID()));
-                    if (!channel)
-                    {
-                        if (lerr!=IMPORT_NOCHANNEL)
-                            esyslogs(Source,"channel %s not found in channels.conf",
-                                     xevent.ChannelID());
-                        lerr=IMPORT_NOCHANNEL;
-                        if (lastChannelID)
-                        {
-                            free(lastChannelID);
-                            lastChannelID=NULL;
-                        }
-                        continue;
-                    }
+        const char *channelid=(const char *) sqlite3_column_text(stmt,cols[COL_CHANNELID]);
+        if (!channelid) continue;
 
-                    schedule = (cSchedule *) schedules->GetSchedule(channel,addevents);
-                    if (!schedule)
-                    {
-                        if (lerr!=IMPORT_NOSCHEDULE)
-                            esyslogs(Source,"cannot get schedule for channel %s%s",
-                                     channel->Name(),addevents ? "" : " - try add option");
-                        lerr=IMPORT_NOSCHEDULE;
-                        if (lastChannelID)
-                        {
-                            free(lastChannelID);
-                            lastChannelID=NULL;
-                        }
-                        continue;
-                    }
-                    if (lastChannelID) free(lastChannelID);
-                    lastChannelID=strdup(xevent.ChannelID());
-                    hint=0;
+        if (!lastChannelID || strcmp(lastChannelID,channelid))
+        {
+            job=NULL;
+            chanid=tChannelID::FromString(channelid);
+            cEPGMapping *map=maps->GetMap(chanid);
+            if (!map)
+            {
+                if (lerr!=IMPORT_NOMAPPING)
+                    esyslogs(Source,"no mapping for channelid %s",channelid);
+                lerr=IMPORT_NOMAPPING;
+                if (lastChannelID)
+                {
+                    free(lastChannelID);
+                    lastChannelID=NULL;
                 }
+                continue;
+            }
+            flags=map->Flags();
 
-                cEvent *event=SearchVDREvent(Source, schedule, &xevent, addevents, hint);
+            addevents=false;
+            if ((flags & OPT_APPEND)==OPT_APPEND) addevents=true;
 
-                if (!addevents)
+            cChannel *channel=Channels.GetByChannelID(chanid);
+            if (!channel)
+            {
+                if (lerr!=IMPORT_NOCHANNEL)
+                    esyslogs(Source,"channel %s not found in channels.conf",channelid);
+                lerr=IMPORT_NOCHANNEL;
+                if (lastChannelID)
                 {
-                    if (event)
-                    {
-                        hint=(int)(event->StartTime()+event->Duration())-(int)(xevent.StartTime()+xevent.Duration());
-                    }
-                    else
-                    {
-                        hint=0;
-                    }
+                    free(lastChannelID);
+                    lastChannelID=NULL;
                 }
-                else
+                continue;
+            }
+
+            schedule = (cSchedule *) schedules->GetSchedule(channel,addevents);
+            if (!schedule)
+            {
+                if (lerr!=IMPORT_NOSCHEDULE)
+                    esyslogs(Source,"cannot get schedule for channel %s%s",
+                             channel->Name(),addevents ? "" : " - try add option");
+                lerr=IMPORT_NOSCHEDULE;
+                if (lastChannelID)
                 {
-                    if (event && (event->EventID() != xevent.EventID()))
-                    {
-                        tsyslogs(Source,"{%5i} changing existing eventid to {%5i}",event->EventID(),xevent.EventID());
-                        event->SetEventID(xevent.EventID());
-                        event->SetVersion(0);
-                        event->SetTableID(0);
-                    }
+                    free(lastChannelID);
+                    lastChannelID=NULL;
                 }
-
-#if VDRVERSNUM < 10726 && (!EPGHANDLER)
-                if ((!addevents) && (xevent.StartTime()>endoneday)) continue;
-#endif
-                if (PutEvent(Source, db, schedule, event, &xevent, flags))
+                continue;
+            }
+            if (lastChannelID) free(lastChannelID);
+            lastChannelID=strdup(channelid);
+            // start with the learned offset of this channel
+            offset=g->TimeOffsets()->Offset(chanid);
+            hint=offset;
+            // PutEvent adds events in append mode, so no index then
+            if (addevents || batch) schedindex.Clear();
+            else schedindex.Build(schedule);
+
+            if (batch && !addevents)
+            {
+                if (batch->Count()>=threads*IMPORT_JOBSPERTHREAD)
                 {
-                    schedules->SetModified(schedule);
-                    cnt++;
+                    cnt+=RunBatch(Source,db,schedules,batch,workers,threads,begin);
                 }
+                job=new cImportJob(chanid,schedule,flags,offset);
+                batch->Add(job);
+            }
+        }
+
+        if (job)
+        {
+            // everything is fetched, the worker cannot use the statement
+            cXMLTVEvent *xev=new cXMLTVEvent();
+            if (!xev) continue;
+            if (FetchXMLTVEvent(stmt,cols,flags,xev,true))
+            {
+                job->Add(xev);
+            }
+            else
+            {
+                delete xev;
+            }
+            continue;
+        }
+
+        if (!FetchXMLTVEvent(stmt,cols,flags,&xevent,false)) continue;
+
+        cEvent *event=SearchVDREvent(Source, schedule, &xevent, addevents, hint, offset,
+                                     schedindex.Valid() ? &schedindex : NULL);
+        if (!event && !addevents)
+        {
+            hint=offset;
+            continue; // no match -> no need for the large columns
+        }
+        FetchHeavyColumns(stmt,cols,flags,&xevent);
+
+        // in append mode the matches may be our own events -> no offset samples
+        if (!addevents)
+        {
+            if (event)
+            {
+                g->TimeOffsets()->Add(chanid,(int) (event->StartTime()-xevent.StartTime()));
+                hint=(int)(event->StartTime()+event->Duration())-(int)(xevent.StartTime()+xevent.Duration());
+            }
+            else
+            {
+                hint=offset;
             }
         }
         else
         {
-            break;
+            if (event && (event->EventID() != xevent.EventID()))
+            {
+                tsyslogs(Source,"{%5i} changing existing eventid to {%5i}",event->EventID(),xevent.EventID());
+                event->SetEventID(xevent.EventID());
+                event->SetVersion(0);
+                event->SetTableID(0);
+            }
+        }
+
+#if VDRVERSNUM < 10726 && (!EPGHANDLER)
+        if ((!addevents) && (xevent.StartTime()>endoneday)) continue;
+#endif
+        if (PutEvent(Source, db, schedule, event, &xevent, flags))
+        {
+            schedules->SetModified(schedule);
+            cnt++;
         }
     }
+    if (lastChannelID) free(lastChannelID);
+    if (batch)
+    {
+        cnt+=RunBatch(Source,db,schedules,batch,workers,threads,begin);
+        for (int i=0; i<threads-1; i++) delete workers[i];
+        free(workers);
+        delete batch;
+    }
+    g->TimeOffsets()->Save(db);
 
     if (Commit(Source,db))
     {
@@ -1801,7 +2183,9 @@ int cImport::Process(cEPGSource *Source, cEPGExecutor &myExecutor)
 
     sqlite3_finalize(stmt);
     sqlite3_close(db);
+    g->DBChanged(); // eiteventids and time offsets
     delete schedulesLock;
+    Source->Stats()->Add(STAT_LOCKTIME,locktime.Elapsed());
     Timers.SetEvents();
     Timers.DecBeingEdited();
     return 0;
@@ -1811,8 +2195,10 @@ bool cImport::DBExists()
 {
     if (!g->EPGFile()) return true; // is this safe?
     struct stat statbuf;
+    AddDB(DBOP_STAT);
     if (stat(g->EPGFile(),&statbuf)==-1) return false; // no database
     if (!statbuf.st_size) return false; // no database
+    dbinode=statbuf.st_ino; // a new epg.db gets a new inode
     return true;
 }
 
@@ -1820,7 +2206,11 @@ cImport::cImport(cGlobals *Global)
 {
     g=Global;
     pendingtransaction=false;
-    conv = new cCharSetConv("UTF-8",g->Codeset());
+    dbstats=NULL;
+    memset(searchstmts,0,sizeof(searchstmts));
+    nextsearchstmt=0;
+    dbinode=openinode=0;
+    conv = new cConvCache("UTF-8",g->Codeset());
 
     if (Global->EPDir())
     {
@@ -1836,7 +2226,134 @@ cImport::cImport(cGlobals *Global)
 
 cImport::~cImport()
 {
+    FinalizeStatements();
     if (cep2ascii!=(iconv_t) -1) iconv_close(cep2ascii);
     if (cutf2ascii!=(iconv_t) -1) iconv_close(cutf2ascii);
     delete conv;
 }
+
+// --------------------------------------------------------------------------------------------------------
+
+cImportJob::cImportJob(tChannelID ChannelID, cSchedule *Schedule, int Flags, int Offset)
+{
+    channelid=ChannelID;
+    schedule=Schedule;
+    flags=Flags;
+    offset=Offset;
+}
+
+cImportJob::~cImportJob()
+{
+    for (int i=0; i<xevents.Size(); i++)
+    {
+        delete xevents[i];
+        free(descriptions[i]);
+    }
+}
+
+void cImportJob::Add(cXMLTVEvent *xEvent)
+{
+    xevents.Append(xEvent);
+    events.Append(NULL);
+    descriptions.Append(NULL);
+    waschanged.Append(0);
+}
+
+void cImportJob::SetResult(int Index, cEvent *Event, bool WasChanged, char *Description)
+{
+    events[Index]=Event;
+    waschanged[Index]=WasChanged ? 1 : 0;
+    free(descriptions[Index]);
+    descriptions[Index]=Description;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cImportBatch::cImportBatch()
+{
+    next=NULL;
+    running=0;
+}
+
+void cImportBatch::Start(int Workers)
+{
+    cMutexLock lock(&mutex);
+    next=First();
+    running=Workers;
+}
+
+cImportJob *cImportBatch::Next()
+{
+    cMutexLock lock(&mutex);
+    cImportJob *job=next;
+    if (job) next=cList<cImportJob>::Next(job);
+    return job;
+}
+
+void cImportBatch::Done()
+{
+    cMutexLock lock(&mutex);
+    running--;
+    finished.Broadcast();
+}
+
+void cImportBatch::Wait()
+{
+    cMutexLock lock(&mutex);
+    while (running>0) finished.Wait(mutex);
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cImportWorker::cImportWorker(cGlobals *Global) : cThread("xmltv2vdr importer"), import(Global)
+{
+    source=NULL;
+    batch=NULL;
+    quit=false;
+}
+
+cImportWorker::~cImportWorker()
+{
+    mutex.Lock();
+    quit=true;
+    work.Broadcast();
+    mutex.Unlock();
+    Cancel(3);
+}
+
+bool cImportWorker::Run(cEPGSource *Source, cImportBatch *Batch)
+{
+    cMutexLock lock(&mutex);
+    if (batch) return false; // still busy, should not happen
+    if (!Active() && !Start()) return false;
+    source=Source;
+    batch=Batch;
+    work.Broadcast();
+    return true;
+}
+
+void cImportWorker::Action()
+{
+    SetPriority(19);
+    for (;;)
+    {
+        mutex.Lock();
+        while (!batch && !quit) work.TimedWait(mutex,1000);
+        if (quit)
+        {
+            mutex.Unlock();
+            break;
+        }
+        cEPGSource *s=source;
+        cImportBatch *b=batch;
+        mutex.Unlock();
+
+        import.MatchJobs(s,b);
+
+        // the batch must be cleared before Done(), else the next Run() fails
+        mutex.Lock();
+        batch=NULL;
+        mutex.Unlock();
+        b->Done();
+    }
+}
@@ -8,6 +8,7 @@
 #ifndef _IMPORT_H
 #define _IMPORT_H
 
+#include <sys/types.h>
 #include <vdr/epg.h>
 #include <vdr/channels.h>
 #include <sqlite3.h>
@@ -15,11 +16,149 @@
 #include "event.h"
 #include "source.h"
 #include "maps.h"
+#include "stats.h"
 
 class cEPGSource;
 class cEPGExecutor;
 class cGlobals;
 
+#define CONVCACHE_SIZE 64
+#define CONVCACHE_MAXLEN 256
+
+class cConvCache
+{
+private:
+    // converted titles/shorttexts, they repeat very often during an import
+    struct entry
+    {
+        unsigned int hash;
+        unsigned int used;
+        char *src;
+        char *dst;
+    } entries[CONVCACHE_SIZE];
+    unsigned int tick;
+    cCharSetConv *conv; // NULL if no conversion is needed
+public:
+    cConvCache(const char *FromCode, const char *ToCode);
+    ~cConvCache();
+    const char *Convert(const char *From, bool Cache=true);
+};
+
+class cScheduleIndex
+{
+private:
+    // events of one locked schedule, sorted by starttime for window
+    // queries and hashed by starttime for exact probes
+    cEvent **events;
+    int numevents;
+    int allocated;
+    int *slots; // index+1, 0 = empty
+    int slotbits;
+    int allocslots;
+    bool valid;
+    static int compare(const void *a, const void *b);
+    unsigned int slot(time_t StartTime) const
+    {
+        return ((unsigned int) StartTime*2654435761u)>>(32-slotbits);
+    }
+public:
+    cScheduleIndex();
+    ~cScheduleIndex();
+    void Build(const cSchedule *Schedule);
+    void Clear()
+    {
+        numevents=0;
+        valid=false;
+    }
+    bool Valid() const
+    {
+        return valid;
+    }
+    cEvent *Get(time_t StartTime) const;
+    int First(time_t From) const;
+    cEvent *Event(int Index) const
+    {
+        return ((Index>=0) && (Index<numevents)) ? events[Index] : NULL;
+    }
+};
+
+#define IMPORT_MAXTHREADS 16
+#define IMPORT_JOBSPERTHREAD 4 // channels per thread in one batch
+
+class cImportJob : public cListObject
+{
+private:
+    // all rows of one channel and the matching results of a worker
+    tChannelID channelid;
+    cSchedule *schedule;
+    int flags;
+    int offset;
+    cVector<cXMLTVEvent *> xevents;
+    cVector<cEvent *> events;
+    cVector<char *> descriptions;
+    cVector<int> waschanged;
+public:
+    cImportJob(tChannelID ChannelID, cSchedule *Schedule, int Flags, int Offset);
+    ~cImportJob();
+    void Add(cXMLTVEvent *xEvent);
+    void SetResult(int Index, cEvent *Event, bool WasChanged, char *Description);
+    tChannelID ChannelID()
+    {
+        return channelid;
+    }
+    cSchedule *Schedule()
+    {
+        return schedule;
+    }
+    int Flags()
+    {
+        return flags;
+    }
+    int Offset()
+    {
+        return offset;
+    }
+    int Count()
+    {
+        return xevents.Size();
+    }
+    cXMLTVEvent *XEvent(int Index)
+    {
+        return xevents[Index];
+    }
+    cEvent *Event(int Index)
+    {
+        return events[Index];
+    }
+    bool WasChanged(int Index)
+    {
+        return waschanged[Index]!=0;
+    }
+    char **Description(int Index)
+    {
+        return &descriptions[Index];
+    }
+};
+
+class cImportBatch : public cList<cImportJob>
+{
+private:
+    cMutex mutex;
+    cCondVar finished;
+    cImportJob *next;
+    int running;
+public:
+    cImportBatch();
+    void Start(int Workers);
+    cImportJob *Next();
+    void Done();
+    void Wait();
+};
+
+class cImportWorker;
+
+#define IMPORT_SEARCHSTMTS 8 // cached statements of SearchXMLTVEvent
+
 class cImport
 {
 private:
@@ -38,44 +177,137 @@ private:
         IMPORT_NOCHANNELID,
         IMPORT_EMPTYSCHEDULE
     };
+    enum
+    {
+        SEARCH_SOUNDEX=0,
+        SEARCH_TITLE
+    };
+    enum
+    {
+        COL_CHANNELID=0,
+        COL_EVENTID,
+        COL_STARTTIME,
+        COL_DURATION,
+        COL_TITLE,
+        COL_ORIGTITLE,
+        COL_SHORTTEXT,
+        COL_DESCRIPTION,
+        COL_COUNTRY,
+        COL_YEAR,
+        COL_CREDITS,
+        COL_CATEGORY,
+        COL_REVIEW,
+        COL_RATING,
+        COL_STARRATING,
+        COL_VIDEO,
+        COL_AUDIO,
+        COL_SEASON,
+        COL_EPISODE,
+        COL_EPISODEOVERALL,
+        COL_PICS,
+        COL_SRC,
+        COL_EITEVENTID,
+        COL_EITDESCRIPTION,
+        COL_ALTTITLE,
+        COL_CONTENTS,
+        COL_MAX
+    };
     cGlobals *g;
-    cCharSetConv *conv;
+    cConvCache *conv;
     iconv_t cep2ascii;
     iconv_t cutf2ascii;
     bool pendingtransaction;
+    cScheduleIndex schedindex;
+    cHandlerStats *dbstats;
+    struct searchstmt
+    {
+        sqlite3 *db;
+        int kind;
+        int flags;
+        sqlite3_stmt *stmt;
+        int cols[COL_MAX];
+    } searchstmts[IMPORT_SEARCHSTMTS];
+    int nextsearchstmt;
+    ino_t dbinode;
+    ino_t openinode;
+    void AddDB(int Op)
+    {
+        if (dbstats) dbstats->AddDB(Op);
+    }
     char *RemoveLastCharFromDescription(char *description);
     char *Add2Description(char *description, const char *value);
     char *Add2Description(char *description, const char *name, const char *value);
     char *Add2Description(char *description, const char *name, int value);
-    char *Add2Description(char *description, cXMLTVEvent *xEvent, int Flags, int what);
+    char *Render(char *description, const cRenderPlan *Plan, cXMLTVEvent *xEvent);
     char *AddEOT2Description(char *description, bool checkutf8=false);
     struct split split(char *in, char delim);
     cEvent *GetEventBefore(cSchedule* schedule, time_t start);
-    cEvent *SearchVDREvent(cEPGSource *source, cSchedule* schedule, cXMLTVEvent *event, bool append, int hint);
+    cEvent *SearchVDREvent(cEPGSource *source, cSchedule* schedule, cXMLTVEvent *event, bool append, int hint,
+                           int offset, const cScheduleIndex *Index=NULL);
     cEvent *SearchVDREventByTitle(cEPGSource *source, cSchedule* schedule, const char *Title, time_t StartTime,
-                                  int Duration, int hint);
-    bool FetchXMLTVEvent(sqlite3_stmt *stmt, cXMLTVEvent *xevent);
+                                  int Duration, int hint, int offset, const cScheduleIndex *Index=NULL,
+                                  bool *Exact=NULL);
+    char *SQLColumns(int Flags);
+    void MapColumns(sqlite3_stmt *stmt, int *Cols);
+    bool FetchXMLTVEvent(sqlite3_stmt *stmt, const int *Cols, int Flags, cXMLTVEvent *xevent, bool Heavy);
+    void FetchHeavyColumns(sqlite3_stmt *stmt, const int *Cols, int Flags, cXMLTVEvent *xevent);
     char *RemoveNonASCII(const char *src);
-    cXMLTVEvent *PrepareAndReturn(sqlite3 **db, char *sql);
+    struct searchstmt *SearchStatement(sqlite3 **Db, int Kind, int Flags);
+    cXMLTVEvent *StepAndReturn(struct searchstmt *Search, int Flags, cXMLTVEvent *Result);
+    char *RenderDescription(cXMLTVEvent *xEvent, int Flags);
+    int RunBatch(cEPGSource *Source, sqlite3 *Db, const cSchedules *Schedules, cImportBatch *Batch,
+                 cImportWorker **Workers, int Threads, time_t Begin);
     int SoundEx(char *SoundEx,char *WordString,int LengthOption,int CensusOption);
 public:
     cImport(cGlobals *Global);
     ~cImport();
+    void SetDBStats(cHandlerStats *Stats)
+    {
+        dbstats=Stats;
+    }
     void LinkPictures(const char *Source, cXMLTVStringList *Pics, tEventID DestID,
                       tChannelID ChanID, bool MakeOld=true);
     int Process(cEPGSource *Source, cEPGExecutor &myExecutor);
+    void MatchJobs(cEPGSource *Source, cImportBatch *Batch);
     bool Begin(cEPGSource *Source, sqlite3 *Db);
     bool Commit(cEPGSource *Source, sqlite3 *Db);
     bool DBExists();
+    bool DBReplaced()
+    {
+        return (openinode!=dbinode);
+    }
+    void FinalizeStatements();
     bool PutEvent(cEPGSource *Source, sqlite3 *Db, cSchedule* Schedule, cEvent *Event,
-                  cXMLTVEvent *xEvent, int Flags);
+                  cXMLTVEvent *xEvent, int Flags, char **Rendered=NULL);
     bool UpdateXMLTVEvent(cEPGSource *Source, sqlite3 *Db, const cEvent *Event, cXMLTVEvent *xEvent,
                           const char *Description);
-    cXMLTVEvent *SearchXMLTVEvent(sqlite3 **Db, const char *ChannelID, const cEvent *Event);
+    cXMLTVEvent *SearchXMLTVEvent(sqlite3 **Db, const char *ChannelID, const cEvent *Event, int Flags,
+                                  cXMLTVEvent *Result=NULL);
+    int SearchXMLTVEvents(sqlite3 **Db, const char *ChannelID, cEvent * const *Events,
+                          cXMLTVEvent **Results, int Count, int Flags);
     cXMLTVEvent *AddXMLTVEvent(cEPGSource *Source, sqlite3 *Db, const char *ChannelID,
                                const cEvent *Event, const char *EITDescription, bool UseEPText);
     void AddShortTextFromEITDescription(cXMLTVEvent *xEvent, const char *EITDescription);
     bool WasChanged(cEvent *Event);
 };
 
+class cImportWorker : public cThread
+{
+private:
+    // the thread stays alive for all batches of an import, it waits
+    // for the next batch (or quit) on the condition variable
+    cImport import;
+    cMutex mutex;
+    cCondVar work;
+    cEPGSource *source;
+    cImportBatch *batch;
+    bool quit;
+protected:
+    virtual void Action();
+public:
+    cImportWorker(cGlobals *Global);
+    ~cImportWorker();
+    bool Run(cEPGSource *Source, cImportBatch *Batch);
+};
+
 #endif
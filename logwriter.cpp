@@ -0,0 +1,163 @@
+/*
+ * logwriter.cpp: A plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "logwriter.h"
+
+cLogWriter::cLogWriter(const char *FileName) : cThread("xmltv2vdr logwriter")
+{
+    filename=strdup(FileName);
+    fd=-1;
+    size=0;
+    buflen=0;
+    buf=(char *) malloc(LOGWRITER_BUFSIZE);
+    slots=(slot *) malloc(LOGWRITER_SLOTS*sizeof(slot));
+    if (slots)
+    {
+        for (unsigned int i=0; i<LOGWRITER_SLOTS; i++) slots[i].seq=i;
+    }
+    enqueuepos=dequeuepos=0;
+    dropped=0;
+}
+
+cLogWriter::~cLogWriter()
+{
+    Stop();
+    drain(); // if the thread never ran
+    if (fd!=-1) close(fd);
+    free(slots);
+    free(buf);
+    free(filename);
+}
+
+bool cLogWriter::Put(const char *Time, int ThreadId, const char *Line)
+{
+    // called from any thread, never blocks
+    if (!slots) return false;
+    slot *s;
+    unsigned int pos=enqueuepos;
+    for (;;)
+    {
+        s=&slots[pos & (LOGWRITER_SLOTS-1)];
+        int diff=(int) (s->seq-pos);
+        if (!diff)
+        {
+            if (__sync_bool_compare_and_swap(&enqueuepos,pos,pos+1)) break;
+        }
+        else if (diff<0)
+        {
+            // queue is full -> we don't wait for the disk
+            __sync_fetch_and_add(&dropped,1);
+            return false;
+        }
+        pos=enqueuepos;
+    }
+    int len=snprintf(s->data,LOGWRITER_RECSIZE,"%s [%i] %s\n",Time,ThreadId,Line);
+    if ((len<0) || (len>=LOGWRITER_RECSIZE))
+    {
+        len=LOGWRITER_RECSIZE-1;
+        s->data[len-1]='\n';
+    }
+    s->len=len;
+    __sync_synchronize();
+    s->seq=pos+1;
+    if ((pos & (LOGWRITER_SLOTS/2-1))==0) wait.Signal(); // half full
+    return true;
+}
+
+bool cLogWriter::open()
+{
+    if (fd!=-1) return true;
+    fd=::open(filename,O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC,0644);
+    if (fd==-1) return false;
+    struct stat statbuf;
+    size=(fstat(fd,&statbuf)==-1) ? 0 : statbuf.st_size;
+    return true;
+}
+
+void cLogWriter::rotate()
+{
+    if (size<LOGWRITER_MAXSIZE) return;
+    char *old;
+    if (asprintf(&old,"%s.1",filename)==-1) return;
+    close(fd);
+    fd=-1;
+    rename(filename,old);
+    free(old);
+    open();
+}
+
+void cLogWriter::flush()
+{
+    if (!buflen) return;
+    if (open())
+    {
+        char *p=buf;
+        int left=buflen;
+        while (left>0)
+        {
+            ssize_t ret=write(fd,p,left);
+            if (ret<=0) break;
+            p+=ret;
+            left-=ret;
+            size+=ret;
+        }
+        rotate();
+    }
+    buflen=0;
+}
+
+bool cLogWriter::drain()
+{
+    // returns true if there was something to write
+    if (!slots || !buf) return false;
+    bool ret=false;
+    for (;;)
+    {
+        slot *s=&slots[dequeuepos & (LOGWRITER_SLOTS-1)];
+        if ((int) (s->seq-(dequeuepos+1))<0) break; // empty
+        if (buflen+s->len>LOGWRITER_BUFSIZE) flush();
+        memcpy(buf+buflen,s->data,s->len);
+        buflen+=s->len;
+        __sync_synchronize();
+        s->seq=dequeuepos+LOGWRITER_SLOTS;
+        dequeuepos++;
+        ret=true;
+    }
+    int lost=__sync_lock_test_and_set(&dropped,0);
+    if (lost && (buflen+LOGWRITER_RECSIZE<=LOGWRITER_BUFSIZE))
+    {
+        buflen+=snprintf(buf+buflen,LOGWRITER_RECSIZE,"*** %i lines dropped\n",lost);
+    }
+    flush();
+    return ret;
+}
+
+void cLogWriter::Action()
+{
+    while (Running())
+    {
+        if (!drain()) wait.Wait(LOGWRITER_FLUSH);
+    }
+    drain();
+}
+
+void cLogWriter::Stop()
+{
+    if (Active())
+    {
+        Cancel(-1);
+        wait.Signal();
+        Cancel(3);
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * logwriter.h: A plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef _LOGWRITER_H
+#define _LOGWRITER_H
+
+#include <vdr/thread.h>
+
+#define LOGWRITER_SLOTS 4096            // must be a power of two
+#define LOGWRITER_RECSIZE 512           // longer lines are cut
+#define LOGWRITER_BUFSIZE 65536
+#define LOGWRITER_FLUSH 250             // ms between flushes
+#define LOGWRITER_MAXSIZE (20*1024*1024) // rotate to FILE.1 if larger
+
+class cLogWriter : public cThread
+{
+private:
+    // bounded lock-free queue (D. Vyukov): many producers, one consumer
+    struct slot
+    {
+        volatile unsigned int seq;
+        int len;
+        char data[LOGWRITER_RECSIZE];
+    };
+    slot *slots;
+    volatile unsigned int enqueuepos;
+    unsigned int dequeuepos;
+    volatile int dropped;
+    cCondWait wait;
+    char *filename;
+    int fd;
+    off_t size;
+    char *buf;
+    int buflen;
+    bool open();
+    void rotate();
+    void flush();
+    bool drain();
+protected:
+    virtual void Action();
+public:
+    cLogWriter(const char *FileName);
+    ~cLogWriter();
+    bool Put(const char *Time, int ThreadId, const char *Line);
+    void Stop();
+};
+
+#endif
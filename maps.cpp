@@ -28,6 +28,71 @@ void cTEXTMapping::ChangeValue(const char *Value)
 
 // --------------------------------------------------------------------------------------------------------
 
+cContentMapping::cContentMapping(const char *Name, uchar Content)
+{
+    name=strdup(Name);
+    content=Content;
+}
+
+cContentMapping::~cContentMapping()
+{
+    if (name) free(name);
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+bool cContentMappings::ReadIn(const char *ConfDir)
+{
+    // lines are "category = 0xNN", lines starting with # are comments
+    Clear();
+    if (!ConfDir) return false;
+    char *fname=NULL;
+    if (asprintf(&fname,"%s/%s",ConfDir,CONTENTS_CONF)==-1) return false;
+    FILE *f=fopen(fname,"r");
+    if (!f)
+    {
+        free(fname);
+        return false;
+    }
+    size_t lsize;
+    char *line=NULL;
+    int linenr=0;
+    while (getline(&line,&lsize,f)!=-1)
+    {
+        linenr++;
+        char *eq=strchr(line,'#');
+        if (eq) *eq=0;
+        eq=strrchr(line,'=');
+        if (!eq) continue;
+        *eq=0;
+        char *name=compactspace(line);
+        unsigned int hval=0;
+        if (!*name || (sscanf(eq+1," %x",&hval)!=1) || !hval || (hval>0xFF))
+        {
+            esyslog("%s:%i: invalid content mapping",fname,linenr);
+            continue;
+        }
+        Add(new cContentMapping(name,(uchar) hval));
+    }
+    if (line) free(line);
+    fclose(f);
+    isyslog("read %i content mappings from %s",Count(),fname);
+    free(fname);
+    return true;
+}
+
+uchar cContentMappings::Content(const char *Category)
+{
+    if (!Category) return 0;
+    for (cContentMapping *map=First(); map; map=Next(map))
+    {
+        if (!strcasecmp(map->Name(),Category)) return map->Content();
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
 void cTEXTMappings::Remove()
 {
     cTEXTMapping *maps;
@@ -117,6 +182,372 @@ cEPGMapping *cEPGMappings::GetMap(tChannelID ChannelID)
 
 // --------------------------------------------------------------------------------------------------------
 
+const char *cRenderPlan::Label(const char *Name) const
+{
+    if (!Name) return NULL;
+    int lo=0,hi=numlabels-1;
+    while (lo<=hi)
+    {
+        int mid=(lo+hi)/2;
+        int ret=strcmp(Name,labels[mid].name);
+        if (!ret) return labels[mid].value;
+        if (ret<0) hi=mid-1;
+        else lo=mid+1;
+    }
+    return NULL;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cEPGMappingSnapshot::cEPGMappingSnapshot(cEPGMappings *Mappings, cTEXTMappings *TextMappings,
+        const char *Order)
+{
+    readers=0;
+    nextretired=NULL;
+    maps=byname=NULL;
+    slots=NULL;
+    slotmask=0;
+    nummaps=allflags=0;
+    order=Order ? strdup(Order) : NULL;
+    labels=NULL;
+    plans=NULL;
+    numlabels=numplans=0;
+
+    if (TextMappings && TextMappings->Count())
+    {
+        labels=(tTextLabel *) malloc(TextMappings->Count()*sizeof(tTextLabel));
+        if (labels)
+        {
+            for (cTEXTMapping *text=TextMappings->First(); text; text=TextMappings->Next(text))
+            {
+                labels[numlabels].name=strdup(text->Name());
+                labels[numlabels].value=strdup(text->Value());
+                numlabels++;
+            }
+            qsort(labels,numlabels,sizeof(tTextLabel),comparelabel);
+        }
+    }
+
+    if (!Mappings || !Mappings->Count()) return;
+
+    int cnt=Mappings->Count();
+    maps=(cEPGMapping **) malloc(cnt*sizeof(cEPGMapping *));
+    byname=(cEPGMapping **) malloc(cnt*sizeof(cEPGMapping *));
+    if (!maps || !byname) return;
+
+    int chancnt=0;
+    for (cEPGMapping *map=Mappings->First(); map; map=Mappings->Next(map))
+    {
+        maps[nummaps]=new cEPGMapping(*map);
+        byname[nummaps]=maps[nummaps];
+        allflags|=map->Flags();
+        chancnt+=map->NumChannelIDs();
+        nummaps++;
+    }
+    qsort(byname,nummaps,sizeof(cEPGMapping *),comparename);
+
+    // one render plan for every flag combination in use, the timer
+    // thread and the handler (epall) also use USE_SEASON alone
+    plans=(cRenderPlan *) malloc((nummaps+1)*sizeof(cRenderPlan));
+    if (plans)
+    {
+        for (int i=0; i<=nummaps; i++)
+        {
+            int flags=(i<nummaps) ? maps[i]->Flags() : USE_SEASON;
+            if (RenderPlan(flags)) continue;
+            BuildRenderPlan(flags,&plans[numplans]);
+            numplans++;
+        }
+    }
+
+    if (!chancnt) return;
+    // open addressing, at most half of the slots are used
+    unsigned int size=16;
+    while (size<(unsigned int) (chancnt*2)) size<<=1;
+    slots=(struct chanslot *) calloc(size,sizeof(struct chanslot));
+    if (!slots) return;
+    slotmask=size-1;
+    for (int i=0; i<nummaps; i++)
+    {
+        for (int x=0; x<maps[i]->NumChannelIDs(); x++)
+        {
+            tChannelID channelid=maps[i]->ChannelIDs()[x];
+            if (channelid==tChannelID::InvalidID) continue;
+            unsigned int pos=hash(channelid) & slotmask;
+            while (slots[pos].map && !(slots[pos].channelid==channelid)) pos=(pos+1) & slotmask;
+            if (!slots[pos].map)
+            {
+                // first mapping with this channel wins (like cEPGMappings::GetMap)
+                slots[pos].channelid=channelid;
+                slots[pos].map=maps[i];
+                slots[pos].flags=((unsigned int) maps[i]->Flags() & ~OPT_APPEND) | CHANNEL_MAPPED;
+            }
+            if ((maps[i]->Flags() & OPT_APPEND)==OPT_APPEND) slots[pos].flags|=OPT_APPEND;
+        }
+    }
+}
+
+cEPGMappingSnapshot::~cEPGMappingSnapshot()
+{
+    for (int i=0; i<nummaps; i++) delete maps[i];
+    free(maps);
+    free(byname);
+    free(slots);
+    free(plans);
+    free(order);
+    for (int i=0; i<numlabels; i++)
+    {
+        free(labels[i].name);
+        free(labels[i].value);
+    }
+    free(labels);
+}
+
+int cEPGMappingSnapshot::comparelabel(const void *a, const void *b)
+{
+    return strcmp(((const tTextLabel *) a)->name,((const tTextLabel *) b)->name);
+}
+
+const cRenderPlan *cEPGMappingSnapshot::RenderPlan(int Flags)
+{
+    Flags&=RENDER_FLAGS;
+    for (int i=0; i<numplans; i++)
+    {
+        if (plans[i].flags==Flags) return &plans[i];
+    }
+    return NULL;
+}
+
+void cEPGMappingSnapshot::BuildRenderPlan(int Flags, cRenderPlan *Plan)
+{
+    Plan->flags=Flags & RENDER_FLAGS;
+    Plan->numsteps=0;
+    Plan->labels=labels;
+    Plan->numlabels=numlabels;
+#if VDRVERSNUM < 10711 && !EPGHANDLER
+    Flags|=OPT_RATING_TEXT; // always add to text if we dont have the internal tag!
+#endif
+
+    const char *ot=order;
+    if (!ot) return;
+    while (*ot && (Plan->numsteps<RENDER_MAXSTEPS))
+    {
+        if (*ot==',') ot++;
+        tRenderStep *step=&Plan->steps[Plan->numsteps];
+        step->what=0;
+        step->label[0]=step->label[1]=step->label[2]=NULL;
+
+        if (!strncmp(ot,"LOT",3))
+        {
+            // longtext is always there (at least the eit description)
+            step->what=USE_LONGTEXT;
+        }
+        if (!strncmp(ot,"CRS",3) && ((Flags & USE_CREDITS)==USE_CREDITS))
+        {
+            step->what=USE_CREDITS;
+        }
+        if (!strncmp(ot,"CAD",3) && ((Flags & USE_COUNTRYDATE)==USE_COUNTRYDATE))
+        {
+            step->what=USE_COUNTRYDATE;
+            step->label[0]=Plan->Label("country");
+            step->label[1]=Plan->Label("year");
+        }
+        if (!strncmp(ot,"ORT",3) && ((Flags & USE_ORIGTITLE)==USE_ORIGTITLE))
+        {
+            step->what=USE_ORIGTITLE;
+            step->label[0]=Plan->Label("originaltitle");
+        }
+        if (!strncmp(ot,"CAT",3) && ((Flags & USE_CATEGORIES)==USE_CATEGORIES))
+        {
+            step->what=USE_CATEGORIES;
+            step->label[0]=Plan->Label("category");
+        }
+        if (!strncmp(ot,"VID",3) && ((Flags & USE_VIDEO)==USE_VIDEO))
+        {
+            step->what=USE_VIDEO;
+            step->label[0]=Plan->Label("video");
+            step->label[1]=Plan->Label("blacknwhite");
+        }
+        if (!strncmp(ot,"AUD",3) && ((Flags & USE_AUDIO)==USE_AUDIO))
+        {
+            step->what=USE_AUDIO;
+            step->label[0]=Plan->Label("audio");
+        }
+        if (!strncmp(ot,"SEE",3) && ((Flags & USE_SEASON)==USE_SEASON))
+        {
+            step->what=USE_SEASON;
+            step->label[0]=Plan->Label("season");
+            step->label[1]=Plan->Label("episode");
+            step->label[2]=Plan->Label("episodeoverall");
+        }
+        if (!strncmp(ot,"RAT",3) && ((Flags & USE_RATING)==USE_RATING) &&
+                ((Flags & OPT_RATING_TEXT)==OPT_RATING_TEXT))
+        {
+            step->what=USE_RATING;
+        }
+        if (!strncmp(ot,"STR",3) && ((Flags & USE_STARRATING)==USE_STARRATING))
+        {
+            step->what=USE_STARRATING;
+            step->label[0]=Plan->Label("starrating");
+        }
+        if (!strncmp(ot,"REV",3) && ((Flags & USE_REVIEW)==USE_REVIEW))
+        {
+            step->what=USE_REVIEW;
+            step->label[0]=Plan->Label("review");
+        }
+
+        // steps which cannot output anything are left out
+        bool needlabel=(step->what==USE_ORIGTITLE) || (step->what==USE_CATEGORIES) ||
+                       (step->what==USE_VIDEO) || (step->what==USE_AUDIO) ||
+                       (step->what==USE_STARRATING) || (step->what==USE_REVIEW);
+        if (step->what && (!needlabel || step->label[0])) Plan->numsteps++;
+
+        ot+=3;
+    }
+}
+
+int cEPGMappingSnapshot::comparename(const void *a, const void *b)
+{
+    cEPGMapping *m1=*(cEPGMapping **) a;
+    cEPGMapping *m2=*(cEPGMapping **) b;
+    return strcmp(m1->ChannelName(),m2->ChannelName());
+}
+
+unsigned int cEPGMappingSnapshot::hash(const tChannelID &ChannelID)
+{
+    unsigned int h=(unsigned int) ChannelID.Source();
+    h=h*31+(unsigned int) ChannelID.Nid();
+    h=h*31+(unsigned int) ChannelID.Tid();
+    h=h*31+(unsigned int) ChannelID.Sid();
+    h=h*31+(unsigned int) ChannelID.Rid();
+    h^=h>>16;
+    h*=0x45d9f3b;
+    h^=h>>16;
+    return h;
+}
+
+struct cEPGMappingSnapshot::chanslot *cEPGMappingSnapshot::slot(const tChannelID &ChannelID)
+{
+    if (!slots) return NULL;
+    unsigned int pos=hash(ChannelID) & slotmask;
+    while (slots[pos].map)
+    {
+        if (slots[pos].channelid==ChannelID) return &slots[pos];
+        pos=(pos+1) & slotmask;
+    }
+    return NULL;
+}
+
+cEPGMapping *cEPGMappingSnapshot::GetMap(const char *ChannelName)
+{
+    if (!ChannelName || !nummaps) return NULL;
+    int lo=0,hi=nummaps-1;
+    while (lo<=hi)
+    {
+        int mid=(lo+hi)/2;
+        int ret=strcmp(ChannelName,byname[mid]->ChannelName());
+        if (!ret) return byname[mid];
+        if (ret<0) hi=mid-1;
+        else lo=mid+1;
+    }
+    return NULL;
+}
+
+cEPGMapping *cEPGMappingSnapshot::GetMap(tChannelID ChannelID)
+{
+    struct chanslot *s=slot(ChannelID);
+    return s ? s->map : NULL;
+}
+
+bool cEPGMappingSnapshot::ProcessChannel(tChannelID ChannelID)
+{
+    return ((ChannelFlags(ChannelID) & CHANNEL_MAPPED)!=0);
+}
+
+bool cEPGMappingSnapshot::IgnoreChannel(const cChannel *Channel)
+{
+    if (!Channel) return false;
+    return ((ChannelFlags(Channel->GetChannelID()) & OPT_APPEND)!=0);
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cEPGMappingSnapshots::cEPGMappingSnapshots()
+{
+    current=new cEPGMappingSnapshot(NULL,NULL,NULL);
+    retired=NULL;
+    entering=0;
+}
+
+cEPGMappingSnapshots::~cEPGMappingSnapshots()
+{
+    // all readers are gone at this point
+    while (retired)
+    {
+        cEPGMappingSnapshot *next=retired->nextretired;
+        delete retired;
+        retired=next;
+    }
+    delete current;
+}
+
+cEPGMappingSnapshot *cEPGMappingSnapshots::Acquire()
+{
+    // "entering" covers the gap between reading current and
+    // incrementing its reader count (see Reclaim)
+    __sync_add_and_fetch(&entering,1);
+    cEPGMappingSnapshot *snapshot=(cEPGMappingSnapshot *) __sync_fetch_and_add(&current,0);
+    __sync_add_and_fetch(&snapshot->readers,1);
+    __sync_sub_and_fetch(&entering,1);
+    return snapshot;
+}
+
+void cEPGMappingSnapshots::Release(cEPGMappingSnapshot *Snapshot)
+{
+    if (Snapshot) __sync_sub_and_fetch(&Snapshot->readers,1);
+}
+
+void cEPGMappingSnapshots::Publish(cEPGMappings *Mappings, cTEXTMappings *TextMappings, const char *Order)
+{
+    // build the new snapshot (with the indexes) before taking it online
+    cEPGMappingSnapshot *snapshot=new cEPGMappingSnapshot(Mappings,TextMappings,Order);
+    cMutexLock lock(&mutex);
+    cEPGMappingSnapshot *old=__sync_lock_test_and_set(&current,snapshot);
+    old->nextretired=retired;
+    retired=old;
+    __sync_synchronize();
+    reclaim();
+}
+
+void cEPGMappingSnapshots::Reclaim()
+{
+    cMutexLock lock(&mutex);
+    reclaim();
+}
+
+void cEPGMappingSnapshots::reclaim()
+{
+    // a reader may have loaded a retired snapshot without incrementing its
+    // count yet -> only free if nobody is between these two steps
+    if (__sync_fetch_and_add(&entering,0)) return;
+    cEPGMappingSnapshot **prev=&retired;
+    while (*prev)
+    {
+        cEPGMappingSnapshot *snapshot=*prev;
+        if (!__sync_fetch_and_add(&snapshot->readers,0))
+        {
+            *prev=snapshot->nextretired;
+            delete snapshot;
+        }
+        else
+        {
+            prev=&snapshot->nextretired;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------
+
 cEPGMapping::cEPGMapping(const char *ChannelName, const char *Flags_and_Channels)
 {
     channelname=strdup(ChannelName);
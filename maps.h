@@ -10,6 +10,7 @@
 
 #include <vdr/channels.h>
 #include <vdr/tools.h>
+#include <vdr/thread.h>
 
 // Flags field definition
 
@@ -43,6 +44,11 @@
 #define OPT_SEASON_STEXTITLE   0x4000000
 #define OPT_APPEND             0x40000000
 
+// Channel flags (cEPGMappingSnapshot::ChannelFlags): the flags of the
+// first mapping with this channel, OPT_APPEND is set if any mapping with
+// this channel has it, bit 31 is set for every mapped channel.
+#define CHANNEL_MAPPED         0x80000000
+
 #define EPLIST_USE_SEASON      0x1
 #define EPLIST_USE_STEXTITLE   0x2
 
@@ -72,6 +78,34 @@ public:
     void Remove();
 };
 
+// text category -> dvb content code, read from <confdir>/contents.conf
+#define CONTENTS_CONF "contents.conf"
+
+class cContentMapping : public cListObject
+{
+private:
+    char *name;
+    uchar content;
+public:
+    cContentMapping(const char *Name, uchar Content);
+    ~cContentMapping();
+    const char *Name(void)
+    {
+        return name;
+    }
+    uchar Content(void)
+    {
+        return content;
+    }
+};
+
+class cContentMappings : public cList<cContentMapping>
+{
+public:
+    bool ReadIn(const char *ConfDir);
+    uchar Content(const char *Category);
+};
+
 class cEPGMapping : public cListObject
 {
 private:
@@ -122,4 +156,135 @@ public:
     void Remove();
 };
 
+// Flags which change the description (see cImport::Render)
+#define RENDER_FLAGS (USE_LONGTEXT|USE_CREDITS|USE_COUNTRYDATE|USE_ORIGTITLE|USE_CATEGORIES| \
+                      USE_VIDEO|USE_AUDIO|USE_SEASON|USE_RATING|USE_STARRATING|USE_REVIEW| \
+                      CREDITS_ACTORS|CREDITS_DIRECTORS|CREDITS_OTHERS|CREDITS_LIST| \
+                      OPT_RATING_TEXT|OPT_APPEND)
+
+#define RENDER_MAXSTEPS 16
+
+struct tTextLabel
+{
+    char *name;
+    char *value;
+};
+
+struct tRenderStep
+{
+    int what; // USE_ flag
+    const char *label[3];
+};
+
+// Description layout for one combination of flags, built from the order
+// and the text mappings. Only enabled fields are in the steps.
+class cRenderPlan
+{
+public:
+    int flags;
+    int numsteps;
+    tRenderStep steps[RENDER_MAXSTEPS];
+    const tTextLabel *labels;
+    int numlabels;
+    const char *Label(const char *Name) const;
+};
+
+// Immutable, indexed copy of the mappings. Readers in other threads
+// (handler, parser, importer, timer) only use these, the setup menu
+// changes cEPGMappings and publishes a new snapshot afterwards.
+class cEPGMappingSnapshot
+{
+    friend class cEPGMappingSnapshots;
+private:
+    struct chanslot
+    {
+        tChannelID channelid;
+        unsigned int flags; // see CHANNEL_ (bit 31) and OPT_APPEND below
+        cEPGMapping *map;
+    };
+    int readers;
+    cEPGMappingSnapshot *nextretired;
+    cEPGMapping **maps;
+    cEPGMapping **byname;
+    int nummaps;
+    struct chanslot *slots;
+    unsigned int slotmask;
+    int allflags;
+    char *order;
+    tTextLabel *labels;
+    int numlabels;
+    cRenderPlan *plans;
+    int numplans;
+    static int comparename(const void *a, const void *b);
+    static int comparelabel(const void *a, const void *b);
+    static unsigned int hash(const tChannelID &ChannelID);
+    struct chanslot *slot(const tChannelID &ChannelID);
+public:
+    cEPGMappingSnapshot(cEPGMappings *Mappings, cTEXTMappings *TextMappings, const char *Order);
+    ~cEPGMappingSnapshot();
+    int Count()
+    {
+        return nummaps;
+    }
+    cEPGMapping *Get(int Index)
+    {
+        return maps[Index];
+    }
+    int AllFlags()
+    {
+        return allflags;
+    }
+    unsigned int ChannelFlags(tChannelID ChannelID)
+    {
+        struct chanslot *s=slot(ChannelID);
+        return s ? s->flags : 0;
+    }
+    cEPGMapping *GetMap(const char *ChannelName);
+    cEPGMapping *GetMap(tChannelID ChannelID);
+    bool ProcessChannel(tChannelID ChannelID);
+    bool IgnoreChannel(const cChannel *Channel);
+    const cRenderPlan *RenderPlan(int Flags);
+    void BuildRenderPlan(int Flags, cRenderPlan *Plan);
+};
+
+// Publishes snapshots without locking the readers. A replaced snapshot
+// is kept in the retired list until no reader uses it anymore.
+class cEPGMappingSnapshots
+{
+private:
+    cMutex mutex;
+    cEPGMappingSnapshot *current;
+    cEPGMappingSnapshot *retired;
+    int entering;
+    void reclaim();
+public:
+    cEPGMappingSnapshots();
+    ~cEPGMappingSnapshots();
+    void Publish(cEPGMappings *Mappings, cTEXTMappings *TextMappings, const char *Order);
+    void Reclaim();
+    cEPGMappingSnapshot *Acquire();
+    void Release(cEPGMappingSnapshot *Snapshot);
+};
+
+class cEPGMappingsReader
+{
+private:
+    cEPGMappingSnapshots *snapshots;
+    cEPGMappingSnapshot *snapshot;
+public:
+    cEPGMappingsReader(cEPGMappingSnapshots *Snapshots)
+    {
+        snapshots=Snapshots;
+        snapshot=snapshots->Acquire();
+    }
+    ~cEPGMappingsReader()
+    {
+        snapshots->Release(snapshot);
+    }
+    cEPGMappingSnapshot *operator->()
+    {
+        return snapshot;
+    }
+};
+
 #endif
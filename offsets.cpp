@@ -0,0 +1,140 @@
+/*
+ * offsets.cpp: A plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "offsets.h"
+
+static int compareint(const void *a, const void *b)
+{
+    return *(const int *) a - *(const int *) b;
+}
+
+cTimeOffset::cTimeOffset(tChannelID ChannelID)
+{
+    channelid=ChannelID;
+    numdeltas=pos=0;
+    median=samples=0;
+}
+
+void cTimeOffset::Set(int Offset, int Samples)
+{
+    // seed the ring with the stored median
+    median=Offset;
+    samples=Samples;
+    numdeltas=pos=0;
+    if (Samples) Add(Offset);
+    samples=Samples;
+}
+
+void cTimeOffset::Add(int Delta)
+{
+    deltas[pos]=Delta;
+    pos=(pos+1) % TIMEOFFSETS_SAMPLES;
+    if (numdeltas<TIMEOFFSETS_SAMPLES) numdeltas++;
+    samples++;
+
+    int sorted[TIMEOFFSETS_SAMPLES];
+    memcpy(sorted,deltas,numdeltas*sizeof(int));
+    qsort(sorted,numdeltas,sizeof(int),compareint);
+    median=sorted[numdeltas/2];
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cTimeOffsets::cTimeOffsets()
+{
+    loaded=dirty=false;
+}
+
+cTimeOffset *cTimeOffsets::get(tChannelID ChannelID)
+{
+    for (cTimeOffset *off=offsets.First(); off; off=offsets.Next(off))
+    {
+        if (off->ChannelID()==ChannelID) return off;
+    }
+    return NULL;
+}
+
+int cTimeOffsets::Offset(tChannelID ChannelID)
+{
+    cMutexLock lock(&mutex);
+    cTimeOffset *off=get(ChannelID);
+    return off ? off->Offset() : 0;
+}
+
+void cTimeOffsets::Add(tChannelID ChannelID, int Delta)
+{
+    if (abs(Delta)>TIMEOFFSETS_MAXDELTA) return;
+    cMutexLock lock(&mutex);
+    cTimeOffset *off=get(ChannelID);
+    if (!off)
+    {
+        off=new cTimeOffset(ChannelID);
+        if (!off) return;
+        offsets.Add(off);
+    }
+    off->Add(Delta);
+    dirty=true;
+}
+
+void cTimeOffsets::Load(sqlite3 *Db)
+{
+    if (!Db) return;
+    cMutexLock lock(&mutex);
+    if (loaded) return;
+    loaded=true;
+
+    sqlite3_stmt *stmt=NULL;
+    if (sqlite3_prepare_v2(Db,"select channelid,offset,samples from timeoffsets;",-1,&stmt,NULL)!=SQLITE_OK)
+    {
+        return; // no table yet
+    }
+    int cnt=0;
+    while (sqlite3_step(stmt)==SQLITE_ROW)
+    {
+        const char *channelid=(const char *) sqlite3_column_text(stmt,0);
+        if (!channelid) continue;
+        tChannelID id=tChannelID::FromString(channelid);
+        if (!id.Valid()) continue;
+        cTimeOffset *off=get(id);
+        if (off) continue; // already learned something newer
+        off=new cTimeOffset(id);
+        if (!off) break;
+        off->Set(sqlite3_column_int(stmt,1),sqlite3_column_int(stmt,2));
+        offsets.Add(off);
+        cnt++;
+    }
+    sqlite3_finalize(stmt);
+    if (cnt) dsyslog("loaded time offsets of %i channels",cnt);
+}
+
+void cTimeOffsets::Save(sqlite3 *Db)
+{
+    // called inside the transaction of the import
+    if (!Db) return;
+    cMutexLock lock(&mutex);
+    if (!dirty) return;
+    if (sqlite3_exec(Db,TIMEOFFSETS_CREATE,NULL,NULL,NULL)!=SQLITE_OK) return;
+
+    sqlite3_stmt *stmt=NULL;
+    if (sqlite3_prepare_v2(Db,"insert or replace into timeoffsets values (?,?,?);",-1,&stmt,NULL)!=SQLITE_OK)
+    {
+        return;
+    }
+    for (cTimeOffset *off=offsets.First(); off; off=offsets.Next(off))
+    {
+        cString channelid=off->ChannelID().ToString();
+        sqlite3_bind_text(stmt,1,*channelid,-1,SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt,2,off->Median());
+        sqlite3_bind_int(stmt,3,off->Samples());
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    dirty=false;
+}
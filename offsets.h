@@ -0,0 +1,70 @@
+/*
+ * offsets.h: A plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef _OFFSETS_H
+#define _OFFSETS_H
+
+#include <vdr/channels.h>
+#include <vdr/thread.h>
+#include <vdr/tools.h>
+#include <sqlite3.h>
+
+// learned start time offset (EIT minus XMLTV) per channel, stored in epg.db
+#define TIMEOFFSETS_CREATE "create table if not exists timeoffsets (channelid text primary key, " \
+                           "offset int, samples int);"
+#define TIMEOFFSETS_SAMPLES 15   // running median over the last samples
+#define TIMEOFFSETS_MINSAMPLES 3 // offset is used after this many samples
+#define TIMEOFFSETS_MAXDELTA 720 // larger deltas are no valid samples
+
+class cTimeOffset : public cListObject
+{
+private:
+    tChannelID channelid;
+    int deltas[TIMEOFFSETS_SAMPLES];
+    int numdeltas;
+    int pos;
+    int median;
+    int samples;
+public:
+    cTimeOffset(tChannelID ChannelID);
+    tChannelID ChannelID()
+    {
+        return channelid;
+    }
+    void Set(int Offset, int Samples);
+    void Add(int Delta);
+    int Offset()
+    {
+        return (samples>=TIMEOFFSETS_MINSAMPLES) ? median : 0;
+    }
+    int Median()
+    {
+        return median;
+    }
+    int Samples()
+    {
+        return samples;
+    }
+};
+
+class cTimeOffsets
+{
+private:
+    cMutex mutex;
+    cList<cTimeOffset> offsets;
+    bool loaded;
+    bool dirty;
+    cTimeOffset *get(tChannelID ChannelID);
+public:
+    cTimeOffsets();
+    int Offset(tChannelID ChannelID);
+    void Add(tChannelID ChannelID, int Delta);
+    void Load(sqlite3 *Db);
+    void Save(sqlite3 *Db);
+};
+
+#endif
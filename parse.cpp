@@ -470,6 +470,7 @@ bool cParse::FetchEvent(xmlNodePtr enode, bool useeptext)
                     else
                     {
                         xevent.AddCategory((const char *) content);
+                        xevent.AddContent(g->ContentMappings()->Content((const char *) content));
                     }
                     xmlFree(content);
                 }
@@ -744,8 +745,11 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
 
     dsyslogs(source,"parsing output");
 
+    cSourceStats *stats=source->Stats();
+    cStatTimer parsetime;
     xmlDocPtr xmltv;
     xmltv=xmlReadMemory(buffer,bufsize,NULL,NULL,0);
+    stats->Add(STAT_PARSETIME,parsetime.Elapsed());
     if (!xmltv)
     {
         esyslogs(source,"failed to parse xmltv");
@@ -768,14 +772,16 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
         return 141;
     }
 
-    char sql[]="CREATE TABLE IF NOT EXISTS epg (" \
+    // auto_vacuum is only set for new databases, housekeeping converts old ones
+    char sql[]="PRAGMA auto_vacuum=INCREMENTAL;" \
+               "CREATE TABLE IF NOT EXISTS epg (" \
                "src nvarchar(100), channelid nvarchar(255), eventid int, eiteventid int, "\
                "starttime datetime, duration int, title nvarchar(255), alttitle nvarchar(255), "\
                "origtitle nvarchar(255), shorttext nvarchar(255), description text, "\
                "eitdescription text, country nvarchar(255), year int, " \
                "credits text, category text, review text, rating text, " \
                "starrating text, video text, audio text, season int, episode int, " \
-               "episodeoverall int, pics text, srcidx int," \
+               "episodeoverall int, pics text, srcidx int, contents blob," \
                "PRIMARY KEY(eventid, src, channelid)" \
                ");" \
                "CREATE INDEX IF NOT EXISTS idx1 on epg (starttime, eiteventid, channelid); " \
@@ -795,6 +801,7 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
 
     time_t begin=time(NULL)-7200;
     xmlNodePtr node=rootnode->xmlChildrenNode;
+    cEPGMappingsReader maps(g->EPGMappingSnapshots());
 
     int lerr=0,lweak=0;
     xmlChar *lastchannelid=NULL;
@@ -822,7 +829,7 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
             skipped++;
             continue;
         }
-        cEPGMapping *map=g->EPGMappings()->GetMap((const char *) channelid);
+        cEPGMapping *map=maps->GetMap((const char *) channelid);
         if (!map)
         {
             if ((lerr!=PARSE_NOMAPPING) || (lastchannelid && xmlStrcmp(channelid,lastchannelid)))
@@ -925,7 +932,9 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
             xevent.GetSQL(source->Name(),source->Index(),map->ChannelIDs()[i].ToString(),&isql,&usql);
             if (isql && usql)
             {
+                cStatTimer sqltime;
                 int ret=sqlite3_exec(db,isql,NULL,NULL,&errmsg);
+                if (ret==SQLITE_OK) stats->Add(STAT_ROWSINSERTED);
                 if (ret!=SQLITE_OK)
                 {
                     bool update_issued=false;
@@ -933,8 +942,10 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
                     {
                         sqlite3_free(errmsg);
                         ret=sqlite3_exec(db,usql,NULL,NULL,&errmsg);
+                        if (ret==SQLITE_OK) stats->Add(STAT_ROWSUPDATED);
                         update_issued=true;
                     }
+                    stats->Add(STAT_SQLTIME,sqltime.Elapsed());
                     if (ret!=SQLITE_OK)
                     {
                         if (lerr!=PARSE_SQLERR)
@@ -966,6 +977,10 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
                         break;
                     }
                 }
+                else
+                {
+                    stats->Add(STAT_SQLTIME,sqltime.Elapsed());
+                }
             }
         }
         node=node->next;
@@ -977,11 +992,15 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
         if (do_unlink) break;
     }
 
+    cStatTimer committime;
     if (sqlite3_exec(db,"COMMIT",NULL,NULL,&errmsg)!=SQLITE_OK)
     {
         esyslogs(source,"sqlite3: COMMIT %s",errmsg);
         sqlite3_free(errmsg);
     }
+    stats->Add(STAT_SQLTIME,committime.Elapsed());
+    stats->Add(STAT_ROWSSKIPPED,skipped);
+    g->DBChanged();
 
     int cnt=sqlite3_total_changes(db);
 
@@ -997,10 +1016,13 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
         isyslogs(source,"processed %i xmltv events - see ERRORs above!",cnt);
     }
 
-    if (sqlite3_exec(db,"ANALYZE epg;",NULL,NULL,&errmsg)!=SQLITE_OK)
+    if (!do_unlink && NeedsAnalyze(db))
     {
-        esyslogs(source,"sqlite3: ANALYZE %s",errmsg);
-        sqlite3_free(errmsg);
+        if (sqlite3_exec(db,"ANALYZE epg;",NULL,NULL,&errmsg)!=SQLITE_OK)
+        {
+            esyslogs(source,"sqlite3: ANALYZE %s",errmsg);
+            sqlite3_free(errmsg);
+        }
     }
 
     sqlite3_close(db);
@@ -1012,6 +1034,33 @@ int cParse::Process(cEPGExecutor &myExecutor,char *buffer, int bufsize)
     return 0;
 }
 
+bool cParse::NeedsAnalyze(sqlite3 *Db)
+{
+    // the first value in sqlite_stat1 is the row count at the last ANALYZE,
+    // only analyze again if the table changed by more than 20%
+    if (!Db) return false;
+    sqlite3_stmt *stmt;
+    int rows=-1,statrows=-1;
+    if (sqlite3_prepare_v2(Db,"select count(*) from epg;",-1,&stmt,NULL)==SQLITE_OK)
+    {
+        if (sqlite3_step(stmt)==SQLITE_ROW) rows=sqlite3_column_int(stmt,0);
+        sqlite3_finalize(stmt);
+    }
+    if (rows<=0) return false;
+    if (sqlite3_prepare_v2(Db,"select stat from sqlite_stat1 where tbl='epg' limit 1;",-1,&stmt,NULL)==SQLITE_OK)
+    {
+        if (sqlite3_step(stmt)==SQLITE_ROW)
+        {
+            const char *stat=(const char *) sqlite3_column_text(stmt,0);
+            if (stat) statrows=atoi(stat);
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (statrows<=0) return true;
+    int diff=abs(rows-statrows);
+    return (diff*5>statrows);
+}
+
 void cParse::InitLibXML()
 {
     xmlInitParser();
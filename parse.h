@@ -11,6 +11,7 @@
 #include <vdr/epg.h>
 #include <libxml/parser.h>
 #include <time.h>
+#include <sqlite3.h>
 
 #include "maps.h"
 #include "event.h"
@@ -50,6 +51,7 @@ public:
                                    const char *Title, const char *ShortText, const char *Description,
                                    int &Season, int &Episode, int &EpisodeOverall, char **EPShortText,
                                    char **EPTitle);
+    static bool NeedsAnalyze(sqlite3 *Db);
     static void InitLibXML();
     static void CleanupLibXML();
 };
@@ -0,0 +1,370 @@
+/*
+ * pics.cpp: A plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "pics.h"
+#include "source.h"
+#include "debug.h"
+
+cPicLink::cPicLink(const char *Source, cXMLTVStringList *Pics, tEventID DestID, tChannelID ChanID, bool MakeOld)
+{
+    source=strdup(Source);
+    chanid=strdup(*ChanID.ToString());
+    destid=DestID;
+    makeold=MakeOld;
+    numpics=0;
+    pics=(char **) malloc(Pics->Size()*sizeof(char *));
+    if (!pics) return;
+    for (int i=0; i<Pics->Size(); i++)
+    {
+        pics[i]=strdup((*Pics)[i]);
+        if (!pics[i]) break;
+        numpics++;
+    }
+}
+
+cPicLink::~cPicLink()
+{
+    if (source) free(source);
+    if (chanid) free(chanid);
+    for (int i=0; i<numpics; i++) free(pics[i]);
+    if (pics) free(pics);
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cPicSourceDir::cPicSourceDir(const char *Source, int Fd)
+{
+    source=strdup(Source);
+    fd=-1;
+    SetFd(Fd);
+}
+
+cPicSourceDir::~cPicSourceDir()
+{
+    if (source) free(source);
+    if (fd!=-1) close(fd);
+}
+
+void cPicSourceDir::SetFd(int Fd)
+{
+    if ((fd!=-1) && (fd!=Fd)) close(fd);
+    fd=Fd;
+    failed=(fd==-1) ? time(NULL) : 0;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+struct pic_dirent64
+{
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+cPicDir::cPicDir(const char *Path)
+{
+    path=strdup(Path);
+    fd=-1;
+    bpos=blen=0;
+    rewind=false;
+}
+
+cPicDir::~cPicDir()
+{
+    if (fd!=-1) close(fd);
+    if (path) free(path);
+}
+
+int cPicDir::Fd()
+{
+    if (fd==-1) fd=open(path,O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    return fd;
+}
+
+const char *cPicDir::Next(unsigned char &Type)
+{
+    // the fd stays open, so the next call continues where the last one
+    // stopped (even in the next housekeeping run). At the end of the
+    // directory NULL is returned once, and we start again from the top.
+    if (Fd()==-1) return NULL;
+    for (;;)
+    {
+        if (bpos>=blen)
+        {
+            if (rewind)
+            {
+                lseek(fd,0,SEEK_SET);
+                rewind=false;
+            }
+            bpos=0;
+            blen=syscall(SYS_getdents64,fd,buf,sizeof(buf));
+            if (blen<=0)
+            {
+                blen=0;
+                rewind=true;
+                return NULL;
+            }
+        }
+        struct pic_dirent64 *d=(struct pic_dirent64 *) (buf+bpos);
+        bpos+=d->d_reclen;
+        if (d->d_name[0]=='.') continue;
+        Type=d->d_type;
+        return d->d_name;
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cPictureLinker::cPictureLinker(const char *ImgDir, const char *EPGFile) : cThread("xmltv2vdr piclinker")
+{
+    imgdir=strdup(ImgDir);
+    epgfile=EPGFile ? strdup(EPGFile) : NULL;
+    imgfd=-1;
+    linked=unchanged=missing=failed=0;
+}
+
+cPictureLinker::~cPictureLinker()
+{
+    Stop();
+    queue.Clear();
+    srcdirs.Clear();
+    if (imgfd!=-1) close(imgfd);
+    if (imgdir) free(imgdir);
+    if (epgfile) free(epgfile);
+}
+
+void cPictureLinker::Add(const char *Source, cXMLTVStringList *Pics, tEventID DestID, tChannelID ChanID, bool MakeOld)
+{
+    // called from the import loop (with cSchedulesLock held) -> just queue it
+    if (!Source || !Pics || !Pics->Size()) return;
+    cPicLink *link=new cPicLink(Source,Pics,DestID,ChanID,MakeOld);
+    if (!link) return;
+    if (!link->NumPics())
+    {
+        delete link;
+        return;
+    }
+    cMutexLock lock(&mutex);
+    queue.Add(link);
+    newlinks.Broadcast();
+}
+
+int cPictureLinker::sourcefd(const char *Source)
+{
+    cPicSourceDir *dir;
+    for (dir=srcdirs.First(); dir; dir=srcdirs.Next(dir))
+    {
+        if (!strcmp(dir->Source(),Source)) break;
+    }
+    if (dir)
+    {
+        if (dir->Fd()!=-1) return dir->Fd();
+        // failures are remembered, so we don't retry for every picture,
+        // but the directory may be created later
+        if (time(NULL)<dir->Failed()+PICS_SRCRETRY) return -1;
+    }
+    char *path;
+    if (asprintf(&path,"%s/%s-img",EPGSOURCES,Source)==-1) return -1;
+    int fd=open(path,O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if ((fd==-1) && !dir) esyslog("cannot open %s",path);
+    free(path);
+    if (dir)
+    {
+        dir->SetFd(fd);
+    }
+    else
+    {
+        srcdirs.Add(new cPicSourceDir(Source,fd));
+    }
+    return fd;
+}
+
+void cPictureLinker::link(int SrcFd, const char *Source, const char *Pic, const char *Name)
+{
+    struct stat statbuf;
+    if (fstatat(SrcFd,Pic,&statbuf,0)==-1)
+    {
+        missing++;
+        return;
+    }
+
+    char target[PATH_MAX];
+    int len=snprintf(target,sizeof(target),"%s/%s-img/%s",EPGSOURCES,Source,Pic);
+    if ((len<0) || (len>=(int) sizeof(target)))
+    {
+        failed++;
+        return;
+    }
+
+    char current[PATH_MAX];
+    ssize_t clen=readlinkat(imgfd,Name,current,sizeof(current));
+    if (clen==len && !memcmp(current,target,len))
+    {
+        unchanged++;
+        if (indexed.Size()<IMGINDEX_MAXPENDING) indexed.Append(strdup(Name));
+        return;
+    }
+    if ((clen!=-1) || (errno!=ENOENT)) unlinkat(imgfd,Name,0);
+
+    if (symlinkat(target,imgfd,Name)==-1)
+    {
+        tsyslog("failed to link %s to %s (%s)",Pic,Name,strerror(errno));
+        failed++;
+    }
+    else
+    {
+        linked++;
+        if (indexed.Size()<IMGINDEX_MAXPENDING) indexed.Append(strdup(Name));
+    }
+}
+
+void cPictureLinker::flushindex()
+{
+    // refresh the age of all links we touched, housekeeping expires them
+    if (!indexed.Size() || !epgfile) return;
+    sqlite3 *db=NULL;
+    if (sqlite3_open_v2(epgfile,&db,SQLITE_OPEN_READWRITE,NULL)!=SQLITE_OK)
+    {
+        sqlite3_close(db);
+        return;
+    }
+    sqlite3_busy_timeout(db,1000);
+    sqlite3_stmt *stmt=NULL;
+    if ((sqlite3_exec(db,IMGINDEX_CREATE,NULL,NULL,NULL)!=SQLITE_OK) ||
+            (sqlite3_exec(db,"BEGIN",NULL,NULL,NULL)!=SQLITE_OK))
+    {
+        // database busy (import running?) -> try again later
+        sqlite3_close(db);
+        return;
+    }
+    const char *sql="insert or replace into imglinks values (?,?);";
+    if (sqlite3_prepare_v2(db,sql,-1,&stmt,NULL)!=SQLITE_OK)
+    {
+        sqlite3_exec(db,"ROLLBACK",NULL,NULL,NULL);
+        sqlite3_close(db);
+        return;
+    }
+    time_t now=time(NULL);
+    for (int i=0; i<indexed.Size(); i++)
+    {
+        sqlite3_bind_text(stmt,1,indexed[i],-1,SQLITE_STATIC);
+        sqlite3_bind_int64(stmt,2,now);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    if (sqlite3_exec(db,"COMMIT",NULL,NULL,NULL)==SQLITE_OK)
+    {
+        indexed.Clear();
+    }
+    else
+    {
+        sqlite3_exec(db,"ROLLBACK",NULL,NULL,NULL);
+    }
+    sqlite3_close(db);
+}
+
+void cPictureLinker::process(cPicLink *Link)
+{
+    // source-pics are located in /var/lib/epgsources/%SOURCE%-img/
+    // dest-pics are located in imgdir (default /var/cache/vdr/epgimages)
+    int srcfd=sourcefd(Link->Source());
+    if (srcfd==-1)
+    {
+        missing+=Link->NumPics();
+        return;
+    }
+
+    char name[NAME_MAX+1];
+    for (int i=0; i<Link->NumPics(); i++)
+    {
+        const char *pic=Link->Pic(i);
+        const char *ext=strrchr(pic,'.');
+        if (!ext) continue;
+        ext++;
+
+        if (Link->MakeOld())
+        {
+            if (!i)
+            {
+                snprintf(name,sizeof(name),"%u.%s",Link->DestID(),ext);
+            }
+            else
+            {
+                snprintf(name,sizeof(name),"%u_%i.%s",Link->DestID(),i,ext);
+            }
+            link(srcfd,Link->Source(),pic,name);
+        }
+
+        if (!i)
+        {
+            snprintf(name,sizeof(name),"%s_%u.%s",Link->ChanID(),Link->DestID(),ext);
+        }
+        else
+        {
+            snprintf(name,sizeof(name),"%s_%u_%i.%s",Link->ChanID(),Link->DestID(),i,ext);
+        }
+        link(srcfd,Link->Source(),pic,name);
+    }
+}
+
+void cPictureLinker::Action()
+{
+    SetPriority(19);
+    while (Running())
+    {
+        cList<cPicLink> batch;
+        mutex.Lock();
+        if (!queue.Count())
+        {
+            if (linked || failed)
+            {
+                dsyslog("linked %i pictures (%i unchanged, %i missing, %i failed)",
+                        linked,unchanged,missing,failed);
+            }
+            linked=unchanged=missing=failed=0;
+            if (indexed.Size())
+            {
+                mutex.Unlock();
+                flushindex();
+                mutex.Lock();
+            }
+            if (!queue.Count()) newlinks.TimedWait(mutex,1000);
+        }
+        cPicLink *link;
+        while ((link=queue.First())!=NULL)
+        {
+            queue.Del(link,false);
+            batch.Add(link);
+        }
+        mutex.Unlock();
+
+        if (!batch.Count()) continue;
+        if (imgfd==-1)
+        {
+            imgfd=open(imgdir,O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+            if (imgfd==-1)
+            {
+                esyslog("cannot open %s",imgdir);
+                continue; // batch is freed
+            }
+        }
+        for (link=batch.First(); link; link=batch.Next(link))
+        {
+            process(link);
+        }
+    }
+}
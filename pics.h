@@ -0,0 +1,137 @@
+/*
+ * pics.h: A plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef _PICS_H
+#define _PICS_H
+
+#include <vdr/thread.h>
+#include <vdr/tools.h>
+#include <vdr/channels.h>
+#include <vdr/epg.h>
+#include <sys/types.h>
+#include <sqlite3.h>
+
+#include "event.h"
+
+// age index of the links in imgdir (see cPictureLinker and cHouseKeeping)
+#define IMGINDEX_CREATE "create table if not exists imglinks (name text primary key, linked int);"
+#define IMGINDEX_MAXPENDING 100000
+#define PICS_SRCRETRY 300 // seconds until a missing source directory is opened again
+
+class cPicLink : public cListObject
+{
+private:
+    char *source;
+    char *chanid;
+    char **pics;
+    int numpics;
+    tEventID destid;
+    bool makeold;
+public:
+    cPicLink(const char *Source, cXMLTVStringList *Pics, tEventID DestID, tChannelID ChanID, bool MakeOld);
+    ~cPicLink();
+    const char *Source()
+    {
+        return source;
+    }
+    const char *ChanID()
+    {
+        return chanid;
+    }
+    int NumPics()
+    {
+        return numpics;
+    }
+    const char *Pic(int Index)
+    {
+        return pics[Index];
+    }
+    tEventID DestID()
+    {
+        return destid;
+    }
+    bool MakeOld()
+    {
+        return makeold;
+    }
+};
+
+class cPicSourceDir : public cListObject
+{
+private:
+    char *source;
+    int fd;
+    time_t failed;
+public:
+    cPicSourceDir(const char *Source, int Fd);
+    ~cPicSourceDir();
+    const char *Source()
+    {
+        return source;
+    }
+    int Fd()
+    {
+        return fd;
+    }
+    time_t Failed()
+    {
+        return failed;
+    }
+    void SetFd(int Fd);
+};
+
+class cPicDir : public cListObject
+{
+private:
+    char *path;
+    int fd;
+    char buf[32768];
+    int bpos;
+    int blen;
+    bool rewind;
+public:
+    cPicDir(const char *Path);
+    ~cPicDir();
+    const char *Path()
+    {
+        return path;
+    }
+    int Fd();
+    const char *Next(unsigned char &Type);
+};
+
+class cPictureLinker : public cThread
+{
+private:
+    cMutex mutex;
+    cCondVar newlinks;
+    cList<cPicLink> queue;
+    cList<cPicSourceDir> srcdirs;
+    cStringList indexed;
+    char *imgdir;
+    char *epgfile;
+    int imgfd;
+    int linked;
+    int unchanged;
+    int missing;
+    int failed;
+    int sourcefd(const char *Source);
+    void link(int SrcFd, const char *Source, const char *Pic, const char *Name);
+    void process(cPicLink *Link);
+    void flushindex();
+public:
+    cPictureLinker(const char *ImgDir, const char *EPGFile);
+    ~cPictureLinker();
+    void Add(const char *Source, cXMLTVStringList *Pics, tEventID DestID, tChannelID ChanID, bool MakeOld=true);
+    void Stop()
+    {
+        Cancel(3);
+    }
+    virtual void Action();
+};
+
+#endif
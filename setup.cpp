@@ -34,6 +34,21 @@ char *strcatrealloc(char *dest, const char *src)
     return dest;
 }
 
+char *strncatrealloc(char *dest, const char *src, size_t n)
+{
+    if (!src || !*src || !n)
+        return dest;
+
+    size_t d = dest ? strlen(dest) : 0;
+    size_t l = strnlen(src, n);
+    char *tmp = (char *)realloc(dest, d + l + 1);
+    if (!tmp)
+        return dest;
+    memcpy(tmp + d, src, l);
+    tmp[d + l] = 0;
+    return tmp;
+}
+
 
 // --------------------------------------------------------------------------------------------------------
 
@@ -542,6 +557,7 @@ void cMenuSetupXmltv2vdrTextMap::Store()
     SetupStore("textmap.season",season);
     SetupStore("textmap.episode",episode);
     SetupStore("textmap.episodeoverall",episodeoverall);
+    g->PublishEPGMappings();
 }
 
 // --------------------------------------------------------------------------------------------------------
@@ -687,6 +703,7 @@ void cMenuSetupXmltv2vdrOrder::Store(void)
 {
     SetupStore("options.order",order);
     g->SetOrder(order);
+    g->PublishEPGMappings();
 }
 
 // --------------------------------------------------------------------------------------------------------
@@ -745,37 +762,25 @@ void cMenuSetupXmltv2vdrLog::output(void)
         Add(NewTitle(tr("log")));
     }
 
-    if (src && src->Log)
+    if (src)
     {
-        char *saveptr;
-        char *log=strdup(src->Log);
-        if (log)
+        cStringList lines(SOURCELOG_ENTRIES);
+        src->Log()->Get(level,&lines);
+        for (int i=0; i<lines.Size(); i++)
         {
-            char *pch=strtok_r(log,"\n",&saveptr);
-            while (pch)
+            const char *line=lines[i];
+            if (font->Width(line)>width)
             {
-                bool outp=false;
-                if (level==VIEW_DEBUG) outp=true;
-                if ((level==VIEW_INFO) && ((pch[0]=='I') || (pch[0]=='E'))) outp=true;
-                if ((level==VIEW_ERROR) && (pch[0]=='E')) outp=true;
-                if (outp)
+                cTextWrapper wrap(line,font,width);
+                for (int w=0; w<wrap.Lines();w++)
                 {
-                    if (font->Width(pch+1)>width)
-                    {
-                        cTextWrapper wrap(pch+1,font,width);
-                        for (int i=0; i<wrap.Lines();i++)
-                        {
-                            Add(new cOsdItem(wrap.GetLine(i),osUnknown,true));
-                        }
-                    }
-                    else
-                    {
-                        Add(new cOsdItem(pch+1,osUnknown,true));
-                    }
+                    Add(new cOsdItem(wrap.GetLine(w),osUnknown,true));
                 }
-                pch=strtok_r(NULL,"\n",&saveptr);
             }
-            free(log);
+            else
+            {
+                Add(new cOsdItem(line,osUnknown,true));
+            }
         }
     }
     if (cur>Count()) cur=Count();
@@ -1322,6 +1327,7 @@ void cMenuSetupXmltv2vdrChannelMap::Store(cEPGMapping *newmapping, bool replacem
     SetupStore(name,value);
     newmapping->ChangeFlags(flags);
     if (replacemapping) epgmappingreplace(newmapping);
+    g->PublishEPGMappings();
 
     free(name);
     free(value);
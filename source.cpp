@@ -124,6 +124,81 @@ void cEPGExecutor::Action()
 
 // -------------------------------------------------------------
 
+cEPGSourceLog::cEPGSourceLog()
+{
+    memset(rings,0,sizeof(rings));
+    seq=0;
+}
+
+cEPGSourceLog::~cEPGSourceLog()
+{
+    Clear();
+}
+
+void cEPGSourceLog::Add(struct tm *Tm, char Level, const char *Text)
+{
+    if (!Text) return;
+    char *line;
+    if (asprintf(&line,"%02i:%02i %s",Tm->tm_hour,Tm->tm_min,Text)==-1) return;
+
+    int l=(Level=='E') ? 0 : ((Level=='I') ? 1 : 2);
+    cMutexLock lock(&mutex);
+    ring *r=&rings[l];
+    entry *e=&r->entries[r->next];
+    free(e->text); // the oldest one, if the ring is full
+    e->text=line;
+    e->seq=seq++;
+    r->next=(r->next+1) % SOURCELOG_ENTRIES;
+    if (r->count<SOURCELOG_ENTRIES) r->count++;
+}
+
+void cEPGSourceLog::Clear()
+{
+    cMutexLock lock(&mutex);
+    for (int l=0; l<3; l++)
+    {
+        for (int i=0; i<SOURCELOG_ENTRIES; i++) free(rings[l].entries[i].text);
+    }
+    memset(rings,0,sizeof(rings));
+}
+
+int cEPGSourceLog::Get(int Levels, cStringList *Lines)
+{
+    // Levels: 1=errors, 2=errors+infos, 3=everything (in order of arrival)
+    if (!Lines) return 0;
+    if (Levels<1) Levels=1;
+    if (Levels>3) Levels=3;
+    cMutexLock lock(&mutex);
+    int pos[3],left[3];
+    for (int l=0; l<Levels; l++)
+    {
+        left[l]=rings[l].count;
+        pos[l]=(rings[l].next-rings[l].count+SOURCELOG_ENTRIES) % SOURCELOG_ENTRIES;
+    }
+    int cnt=0;
+    for (;;)
+    {
+        int best=-1;
+        for (int l=0; l<Levels; l++)
+        {
+            if (!left[l]) continue;
+            if ((best==-1) || ((int) (rings[l].entries[pos[l]].seq-rings[best].entries[pos[best]].seq)<0)) best=l;
+        }
+        if (best==-1) break;
+        char *text=strdup(rings[best].entries[pos[best]].text);
+        if (text)
+        {
+            Lines->Append(text);
+            cnt++;
+        }
+        pos[best]=(pos[best]+1) % SOURCELOG_ENTRIES;
+        left[best]--;
+    }
+    return cnt;
+}
+
+// -------------------------------------------------------------
+
 cEPGSource::cEPGSource(const char *Name, cGlobals *Global)
 {
     if (strcmp(Name,EITSOURCE))
@@ -134,8 +209,6 @@ cEPGSource::cEPGSource(const char *Name, cGlobals *Global)
     confdir=Global->ConfDir();
     epgfile=Global->EPGFile();
     pin=NULL;
-    Log=NULL;
-    loglen=0;
     usepipe=false;
     needpin=false;
     running=false;
@@ -169,7 +242,6 @@ cEPGSource::~cEPGSource()
     }
     free((void *) name);
     if (pin) free((void *) pin);
-    if (Log) free((void *) Log);
     if (parse) delete parse;
     if (import) delete import;
 }
@@ -459,7 +531,11 @@ int cEPGSource::ReadOutput(char *&result, size_t &l)
 
 int cEPGSource::Import(cEPGExecutor &myExecutor)
 {
-    return import->Process(this,myExecutor);
+    stats.StartImport();
+    cStatTimer importtime;
+    int ret=import->Process(this,myExecutor);
+    stats.Add(STAT_IMPORTTIME,importtime.Elapsed());
+    return ret;
 }
 
 int cEPGSource::Execute(cEPGExecutor &myExecutor)
@@ -472,12 +548,9 @@ int cEPGSource::Execute(cEPGExecutor &myExecutor)
     int l_err=0;
     int ret=0;
 
-    if (Log)
-    {
-        free(Log);
-        Log=NULL;
-        loglen=0;
-    }
+    log.Clear();
+    stats.StartGrab();
+    cStatTimer grabtime;
 
     char *cmd=NULL;
     if (asprintf(&cmd,"%s %i '%s' %i ",name,daysinadvance,pin ? pin : "",usepics)==-1)
@@ -674,6 +747,8 @@ int cEPGSource::Execute(cEPGExecutor &myExecutor)
             int returncode=WEXITSTATUS(status);
             if ((!returncode) && (r_out))
             {
+                stats.Add(STAT_GRABTIME,grabtime.Elapsed());
+                stats.Add(STAT_GRABBYTES,l_out);
                 ret=parse->Process(myExecutor,r_out,l_out);
             }
             else
@@ -701,6 +776,8 @@ int cEPGSource::Execute(cEPGExecutor &myExecutor)
                 ret=ReadOutput(result,l);
                 if ((!ret) && (result))
                 {
+                    stats.Add(STAT_GRABTIME,grabtime.Elapsed());
+                    stats.Add(STAT_GRABBYTES,l);
                     ret=parse->Process(myExecutor,result,l);
                 }
                 if (result) free(result);
@@ -783,26 +860,7 @@ void cEPGSource::Store(void)
 
 void cEPGSource::Add2Log(struct tm *Tm, const char Prefix, const char *Line)
 {
-    if (!Line) return;
-
-    char dt[30];
-    strftime(dt,sizeof(dt)-1,"%H:%M ",Tm);
-
-    loglen+=strlen(Line)+3+strlen(dt);
-    char *nptr=(char *) realloc(Log,loglen);
-    if (nptr)
-    {
-        if (!Log) nptr[0]=0;
-        Log=nptr;
-        char prefix[2];
-        prefix[0]=Prefix;
-        prefix[1]=0;
-        strcat(Log,prefix);
-        strcat(Log,dt);
-        strcat(Log,Line);
-        strcat(Log,"\n");
-        Log[loglen-1]=0;
-    }
+    log.Add(Tm,Prefix,Line);
 }
 
 // -------------------------------------------------------------
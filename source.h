@@ -13,6 +13,7 @@
 #include "maps.h"
 #include "import.h"
 #include "parse.h"
+#include "stats.h"
 #include "debug.h"
 
 #define EPGSOURCES "/var/lib/epgsources" // NEVER (!) CHANGE THIS
@@ -44,6 +45,34 @@ public:
 
 class cEPGChannels : public cList<cEPGChannel> {};
 
+#define SOURCELOG_ENTRIES 256 // per level
+
+class cEPGSourceLog
+{
+private:
+    // one ring per level, so debug lines cannot push out the errors
+    struct entry
+    {
+        unsigned int seq;
+        char *text;
+    };
+    struct ring
+    {
+        entry entries[SOURCELOG_ENTRIES];
+        int next;
+        int count;
+    };
+    cMutex mutex;
+    ring rings[3]; // errors, infos, debug
+    unsigned int seq;
+public:
+    cEPGSourceLog();
+    ~cEPGSourceLog();
+    void Add(struct tm *Tm, char Level, const char *Text);
+    void Clear();
+    int Get(int Levels, cStringList *Lines);
+};
+
 class cImport;
 class cGlobals;
 
@@ -54,7 +83,8 @@ private:
     const char *confdir;
     const char *pin;
     const char *epgfile;
-    int loglen;
+    cEPGSourceLog log;
+    cSourceStats stats;
     cParse *parse;
     cImport *import;
     bool ready2parse;
@@ -85,7 +115,14 @@ public:
     time_t NextRunTime(time_t Now=(time_t) 0);
     void Store(void);
     void ChangeChannelSelection(int *Selection);
-    char *Log;
+    cEPGSourceLog *Log()
+    {
+        return &log;
+    }
+    cSourceStats *Stats()
+    {
+        return &stats;
+    }
     bool Disabled()
     {
         return disabled;
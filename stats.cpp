@@ -0,0 +1,212 @@
+/*
+ * stats.cpp: A plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <string.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stats.h"
+
+uint64_t StatNow()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC,&ts)) return 0;
+    return (uint64_t) ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+static void append(cString &Output, const char *Format, ...) __attribute__ ((format (printf, 2, 3)));
+
+static void append(cString &Output, const char *Format, ...)
+{
+    va_list ap;
+    va_start(ap,Format);
+    char *line=NULL;
+    if (vasprintf(&line,Format,ap)!=-1)
+    {
+        Output=cString::sprintf("%s%s",*Output ? *Output : "",line);
+        free(line);
+    }
+    va_end(ap);
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cSourceStats::cSourceStats()
+{
+    memset(values,0,sizeof(values));
+    lastgrab=lastimport=(time_t) 0;
+}
+
+void cSourceStats::Reset()
+{
+    memset(values,0,sizeof(values));
+}
+
+void cSourceStats::StartGrab()
+{
+    for (int i=STAT_FIRSTGRAB; i<STAT_FIRSTIMPORT; i++) values[i]=0;
+    lastgrab=time(NULL);
+}
+
+void cSourceStats::StartImport()
+{
+    for (int i=STAT_FIRSTIMPORT; i<STAT_MAX; i++) values[i]=0;
+    lastimport=time(NULL);
+}
+
+const char *cSourceStats::Name(int Stat)
+{
+    static const char *names[STAT_MAX]=
+    {
+        "grab_usec",
+        "grab_bytes",
+        "parse_usec",
+        "sql_usec",
+        "rows_inserted",
+        "rows_updated",
+        "rows_skipped",
+        "import_usec",
+        "match_usec",
+        "lock_usec",
+        "match_eitid",
+        "match_eventid",
+        "match_exact",
+        "match_fuzzy",
+        "match_alttitle",
+        "match_none"
+    };
+    return ((Stat>=0) && (Stat<STAT_MAX)) ? names[Stat] : "";
+}
+
+void cSourceStats::Print(const char *Source, cString &Output)
+{
+    append(Output,"%s grab_time %li\n",Source,(long) lastgrab);
+    append(Output,"%s import_time %li\n",Source,(long) lastimport);
+    for (int i=0; i<STAT_MAX; i++)
+    {
+        append(Output,"%s %s %" PRIu64 "\n",Source,Name(i),Get(i));
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+cHandlerStats::cHandlerStats()
+{
+    Reset();
+}
+
+void cHandlerStats::Reset()
+{
+    memset(calls,0,sizeof(calls));
+    memset(total,0,sizeof(total));
+    memset(buckets,0,sizeof(buckets));
+    memset(dbops,0,sizeof(dbops));
+}
+
+int cHandlerStats::Bucket(uint64_t Usecs)
+{
+    // 0..3 usec get their own bucket, above four buckets per octave
+    if (Usecs<4) return (int) Usecs;
+    int octave=63-__builtin_clzll(Usecs);
+    int bucket=(octave-1)*4+(int) ((Usecs>>(octave-2)) & 3);
+    if (bucket>=HANDLER_BUCKETS) bucket=HANDLER_BUCKETS-1;
+    return bucket;
+}
+
+uint64_t cHandlerStats::BucketStart(int Bucket)
+{
+    if (Bucket<4) return (uint64_t) Bucket;
+    int octave=Bucket/4+1;
+    return (uint64_t) (4+(Bucket & 3))<<(octave-2);
+}
+
+void cHandlerStats::Add(int Handler, uint64_t Usecs)
+{
+    if ((Handler<0) || (Handler>=HANDLER_MAX)) return;
+    __sync_fetch_and_add(&calls[Handler],1);
+    __sync_fetch_and_add(&total[Handler],Usecs);
+    __sync_fetch_and_add(&buckets[Handler][Bucket(Usecs)],1);
+}
+
+uint64_t cHandlerStats::Percentile(int Handler, double Fraction)
+{
+    // upper bound of the bucket holding the given fraction of all calls
+    if ((Handler<0) || (Handler>=HANDLER_MAX)) return 0;
+    uint64_t cnt=Calls(Handler);
+    if (!cnt) return 0;
+    uint64_t rank=(uint64_t) (Fraction*cnt+0.999999);
+    if (rank<1) rank=1;
+    if (rank>cnt) rank=cnt;
+    uint64_t sum=0;
+    for (int b=0; b<HANDLER_BUCKETS; b++)
+    {
+        sum+=__sync_fetch_and_add(&buckets[Handler][b],0);
+        if (sum>=rank)
+        {
+            if (b==HANDLER_BUCKETS-1) return BucketStart(b);
+            return BucketStart(b+1)-1;
+        }
+    }
+    return BucketStart(HANDLER_BUCKETS-1);
+}
+
+const char *cHandlerStats::Name(int Handler)
+{
+    static const char *names[HANDLER_MAX]=
+    {
+        "ignorechannel",
+        "setshorttext",
+        "setdescription",
+        "handleevent",
+        "sortschedule"
+    };
+    return ((Handler>=0) && (Handler<HANDLER_MAX)) ? names[Handler] : "";
+}
+
+const char *cHandlerStats::DBName(int Op)
+{
+    static const char *names[DBOP_MAX]=
+    {
+        "db_open",
+        "db_select",
+        "db_write",
+        "db_transaction",
+        "db_stat",
+        "db_cached"
+    };
+    return ((Op>=0) && (Op<DBOP_MAX)) ? names[Op] : "";
+}
+
+void cHandlerStats::Print(cString &Output)
+{
+    // hist lists "start:count" for every used bucket, start in usec
+    for (int i=0; i<HANDLER_MAX; i++)
+    {
+        append(Output,"handler %s calls %" PRIu64 "\n",Name(i),Calls(i));
+        append(Output,"handler %s usec %" PRIu64 "\n",Name(i),__sync_fetch_and_add(&total[i],0));
+        append(Output,"handler %s p50_usec %" PRIu64 "\n",Name(i),Percentile(i,0.5));
+        append(Output,"handler %s p99_usec %" PRIu64 "\n",Name(i),Percentile(i,0.99));
+        append(Output,"handler %s p999_usec %" PRIu64 "\n",Name(i),Percentile(i,0.999));
+        char hist[HANDLER_BUCKETS*42+1];
+        int len=0;
+        hist[0]=0;
+        for (int b=0; b<HANDLER_BUCKETS; b++)
+        {
+            uint64_t cnt=__sync_fetch_and_add(&buckets[i][b],0);
+            if (!cnt) continue;
+            len+=snprintf(hist+len,sizeof(hist)-len,"%s%" PRIu64 ":%" PRIu64,len ? "," : "",
+                          BucketStart(b),cnt);
+        }
+        append(Output,"handler %s hist %s\n",Name(i),len ? hist : "-");
+    }
+    for (int i=0; i<DBOP_MAX; i++)
+    {
+        append(Output,"handler %s %" PRIu64 "\n",DBName(i),__sync_fetch_and_add(&dbops[i],0));
+    }
+}
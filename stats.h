@@ -0,0 +1,152 @@
+/*
+ * stats.h: A plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <vdr/tools.h>
+
+uint64_t StatNow(); // monotonic clock in microseconds
+
+class cStatTimer
+{
+private:
+    uint64_t start;
+public:
+    cStatTimer()
+    {
+        start=StatNow();
+    }
+    uint64_t Elapsed()
+    {
+        return StatNow()-start;
+    }
+};
+
+enum
+{
+    // grabber run, reset when the source is executed
+    STAT_GRABTIME=0,
+    STAT_GRABBYTES,
+    STAT_PARSETIME,
+    STAT_SQLTIME,
+    STAT_ROWSINSERTED,
+    STAT_ROWSUPDATED,
+    STAT_ROWSSKIPPED,
+    // import run, reset when the source is imported
+    STAT_IMPORTTIME,
+    STAT_MATCHTIME,
+    STAT_LOCKTIME,
+    STAT_MATCHEITID,
+    STAT_MATCHEVENTID,
+    STAT_MATCHEXACT,
+    STAT_MATCHFUZZY,
+    STAT_MATCHALTTITLE,
+    STAT_MATCHNONE,
+    STAT_MAX
+};
+
+#define STAT_FIRSTGRAB STAT_GRABTIME
+#define STAT_FIRSTIMPORT STAT_IMPORTTIME
+
+class cSourceStats
+{
+private:
+    uint64_t values[STAT_MAX];
+    time_t lastgrab;
+    time_t lastimport;
+public:
+    cSourceStats();
+    void Reset();
+    void StartGrab();
+    void StartImport();
+    void Add(int Stat, uint64_t Value=1)
+    {
+        __sync_fetch_and_add(&values[Stat],Value);
+    }
+    uint64_t Get(int Stat)
+    {
+        return __sync_fetch_and_add(&values[Stat],0);
+    }
+    static const char *Name(int Stat);
+    void Print(const char *Source, cString &Output);
+};
+
+enum
+{
+    HANDLER_IGNORECHANNEL=0,
+    HANDLER_SETSHORTTEXT,
+    HANDLER_SETDESCRIPTION,
+    HANDLER_HANDLEEVENT,
+    HANDLER_SORTSCHEDULE,
+    HANDLER_MAX
+};
+
+enum
+{
+    DBOP_OPEN=0,
+    DBOP_SELECT,
+    DBOP_WRITE,
+    DBOP_TRANSACTION,
+    DBOP_STAT,
+    DBOP_CACHED,
+    DBOP_MAX
+};
+
+// latency buckets, four per power of two microseconds (up to ~67s)
+#define HANDLER_BUCKETS 104
+
+class cHandlerStats
+{
+private:
+    // epg handler calls since start, updated from the eit thread
+    uint64_t calls[HANDLER_MAX];
+    uint64_t total[HANDLER_MAX];
+    uint64_t buckets[HANDLER_MAX][HANDLER_BUCKETS];
+    uint64_t dbops[DBOP_MAX];
+    static int Bucket(uint64_t Usecs);
+    static uint64_t BucketStart(int Bucket);
+public:
+    cHandlerStats();
+    void Reset();
+    void Add(int Handler, uint64_t Usecs);
+    void AddDB(int Op)
+    {
+        __sync_fetch_and_add(&dbops[Op],1);
+    }
+    uint64_t Calls(int Handler)
+    {
+        return __sync_fetch_and_add(&calls[Handler],0);
+    }
+    uint64_t Percentile(int Handler, double Fraction);
+    static const char *Name(int Handler);
+    static const char *DBName(int Op);
+    void Print(cString &Output);
+};
+
+class cHandlerTimer
+{
+private:
+    cHandlerStats *stats;
+    int handler;
+    uint64_t start;
+public:
+    cHandlerTimer(cHandlerStats *Stats, int Handler)
+    {
+        stats=Stats;
+        handler=Handler;
+        start=stats ? StatNow() : 0;
+    }
+    ~cHandlerTimer()
+    {
+        if (stats) stats->Add(handler,StatNow()-start);
+    }
+};
+
+#endif
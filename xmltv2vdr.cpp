@@ -15,12 +15,15 @@
 #include <sqlite3.h>
 #include <time.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <pwd.h>
 #include <netdb.h>
 
 #include "setup.h"
 #include "xmltv2vdr.h"
 #include "debug.h"
+#include "logwriter.h"
 
 int ioprio_set(int which, int who, int ioprio)
 {
@@ -46,6 +49,7 @@ int ioprio_set(int which, int who, int ioprio)
 }
 
 char *logfile=NULL;
+cLogWriter *logwriter=NULL;
 
 void logger(cEPGSource *source, char logtype, const char* format, ...)
 {
@@ -101,11 +105,20 @@ void logger(cEPGSource *source, char logtype, const char* format, ...)
         char dt[30];
         strftime(dt,sizeof(dt)-1,"%b %d %H:%M:%S",&tm);
 
-        FILE *l=fopen(logfile,"a+");
-        if (l)
+        cLogWriter *writer=logwriter;
+        if (writer)
         {
-            fprintf(l,"%s [%i] %s\n",dt,cThread::ThreadId(),ptr);
-            fclose(l);
+            writer->Put(dt,cThread::ThreadId(),ptr);
+        }
+        else
+        {
+            // not started yet
+            FILE *l=fopen(logfile,"a+");
+            if (l)
+            {
+                fprintf(l,"%s [%i] %s\n",dt,cThread::ThreadId(),ptr);
+                fclose(l);
+            }
         }
     }
     switch (logtype)
@@ -265,10 +278,13 @@ cGlobals::cGlobals()
     epghandler=NULL;
     epgtimer=NULL;
     epgseasonepisode=NULL;
+    piclinker=NULL;
     epall=0;
     order=strdup(GetDefaultOrder());
     imgdelafter=30;
+    importthreads=1;
     soundex=false;
+    dbgeneration=0;
 
     if (asprintf(&epgfile,"%s/epg.db",VideoDirectory)==-1) {};
     if (asprintf(&imgdir,"%s","/var/cache/vdr/epgimages")==-1) {};
@@ -334,6 +350,11 @@ cGlobals::~cGlobals()
         epgseasonepisode->Stop();
         delete epgseasonepisode;
     }
+    if (piclinker)
+    {
+        piclinker->Stop();
+        delete piclinker;
+    }
     epgsources.Remove();
     epgmappings.Remove();
     textmappings.Remove();
@@ -391,174 +412,125 @@ bool cGlobals::DBExists()
 
 // -------------------------------------------------------------
 
-cEPGHandler::cEPGHandler(cGlobals* Global): import(Global)
+static int CompareEventChannel(const void *a, const void *b)
 {
-    epall=0;
-    maps=Global->EPGMappings();
-    sources=Global->EPGSources();
-    db=NULL;
-    now=0;
+    // sorts by channel and starttime, so the events of a channel are adjacent
+    const cEvent *ea=*(const cEvent **) a;
+    const cEvent *eb=*(const cEvent **) b;
+    tChannelID ca=ea->ChannelID();
+    tChannelID cb=eb->ChannelID();
+    if (ca.Source()!=cb.Source()) return (ca.Source()<cb.Source()) ? -1 : 1;
+    if (ca.Nid()!=cb.Nid()) return (ca.Nid()<cb.Nid()) ? -1 : 1;
+    if (ca.Tid()!=cb.Tid()) return (ca.Tid()<cb.Tid()) ? -1 : 1;
+    if (ca.Sid()!=cb.Sid()) return (ca.Sid()<cb.Sid()) ? -1 : 1;
+    if (ca.Rid()!=cb.Rid()) return (ca.Rid()<cb.Rid()) ? -1 : 1;
+    if (ea->StartTime()!=eb->StartTime()) return (ea->StartTime()<eb->StartTime()) ? -1 : 1;
+    if (ea!=eb) return (ea<eb) ? -1 : 1;
+    return 0;
 }
 
-bool cEPGHandler::IgnoreChannel(const cChannel* Channel)
+cEPGTimer::cEPGTimer(cGlobals *Global) :
+        cThread("xmltv2vdr timer"),import(Global)
 {
-    now=time(NULL);
-    if (!maps) return false;
-    if (!Channel) return false;
-    return maps->IgnoreChannel(Channel);
+    sources=Global->EPGSources();
+    maps=Global->EPGMappingSnapshots();
+    epall=0;
+    timersstate=0;
+    schedulesmodified=0;
+    fps=NULL;
+    numfps=0;
+    retry=false;
+    reset=false;
 }
 
-bool cEPGHandler::check4proc(cEvent *event, bool &spth, cEPGMapping **map)
+cEPGTimer::~cEPGTimer()
 {
-    if (map) *map=NULL;
-    spth=false;
-    if (!event) return false;
-    if (now>(event->StartTime()+event->Duration())) return false; // event in the past?
-    if (!maps) return false;
-    if (!import.DBExists()) return false;
-
-    cEPGMapping *t_map=maps->GetMap(event->ChannelID());
-    if (!t_map)
-    {
-        if (!epall) return false;
-        if (!event->HasTimer()) return false;
-        if (!event->ShortText()) return false;
-        spth=true;
-    }
-    if (map) *map=t_map;
-    return true;
+    Stop();
+    free(fps);
 }
 
-bool cEPGHandler::SetShortText(cEvent* Event, const char* ShortText)
+int cEPGTimer::comparefp(const void *a, const void *b)
 {
-    // prevent setting empty shorttext
-    if (!ShortText) return true;
-    // prevent setting empty shorttext
-    if (!strlen(ShortText)) return true;
-    // prevent setting shorttext equal to title
-    if (Event->Title() && !strcasecmp(Event->Title(),ShortText)) return true;
-    if (!Event->ShortText())
-    {
-#if VDRDEBUG
-        tsyslog("{%5i} setting stext (%s) of '%s'",Event->EventID(),
-                ShortText,Event->Title());
-#endif
-        return false; // no shorttext? new event! let VDR handle this..
-    }
-    return true;
+    const cTimer *ta=((const timerfp *) a)->timer;
+    const cTimer *tb=((const timerfp *) b)->timer;
+    if (ta==tb) return 0;
+    return (ta<tb) ? -1 : 1;
 }
 
-bool cEPGHandler::SetDescription(cEvent* Event, const char* Description)
+uint64_t cEPGTimer::fingerprint(const cEvent *Event)
 {
-    bool seth;
-    if (!check4proc(Event,seth,NULL)) return false;
-
-    if (import.WasChanged(Event))
-    {
-        // ok we already changed this event!
-        if (!Description) return true; // prevent setting nothing to description
-        int len=strlen(Description);
-        if (!len) return true; // prevent setting nothing to description
-        if (!strcasestr(Event->Description(),Description))
-        {
-            // eit description changed -> set it
-            tsyslog("{%5i} %schanging descr of '%s'",Event->EventID(),seth ? "*" : "",
-                    Event->Title());
-            return false;
-        }
-#ifdef VDRDEBUG
-        tsyslog("{%5i} %salready seen descr '%s'",Event->EventID(),seth ? "*" : "",
-                Event->Title());
-#endif
-        return true;
-    }
-    tsyslog("{%5i} %ssetting descr of '%s'",Event->EventID(),seth ? "*" : "",
-            Event->Title());
-    return false;
+    // FNV-1a over everything that decides if (and how) we process the event
+    uint64_t fp=14695981039346656037ULL;
+#define FPADD(v) fp=(fp ^ (uint64_t) (v))*1099511628211ULL
+    tChannelID id=Event->ChannelID();
+    FPADD(id.Source());
+    FPADD(id.Nid());
+    FPADD(id.Tid());
+    FPADD(id.Sid());
+    FPADD(Event->EventID());
+    FPADD(Event->StartTime());
+    FPADD(Event->Duration());
+    for (const char *p=Event->Title(); p && *p; p++) FPADD((unsigned char) *p);
+    FPADD(0);
+    for (const char *p=Event->ShortText(); p && *p; p++) FPADD((unsigned char) *p);
+    FPADD(Event->Description() ? strlen(Event->Description()) : 0);
+#undef FPADD
+    return fp;
 }
 
-
-bool cEPGHandler::HandleEvent(cEvent* Event)
+bool cEPGTimer::unchanged(const cTimer *Timer, uint64_t Fp)
 {
-    bool special_epall_timer_handling;
-    cEPGMapping *map;
-    if (!check4proc(Event,special_epall_timer_handling,&map)) return false;
-
-    int Flags=0;
-    const char *ChannelID=strdup(*Event->ChannelID().ToString());
-    if (!ChannelID) return false;
-
-    if (special_epall_timer_handling)
-    {
-        Flags=USE_SEASON;
-    }
-    else
-    {
-        // map is always set if seth==false
-        Flags=map->Flags();
-    }
-
-    if (ioprio_set(1,getpid(),7 | 3 << 13)==-1)
-    {
-        tsyslog("failed to set ioprio to 3,7");
-    }
-
-    cEPGSource *source=NULL;
-    cXMLTVEvent *xevent=import.SearchXMLTVEvent(&db,ChannelID,Event);
-    if (!xevent)
-    {
-        if (!epall)
-        {
-            free((void*)ChannelID);
-            return false;
-        }
-        source=sources->GetSource(EITSOURCE);
-        if (!source) tsyslog("no source for %s",EITSOURCE);
-        bool useeptext=((epall & EPLIST_USE_STEXTITLE)==EPLIST_USE_STEXTITLE);
-        if (useeptext) Flags|=(USE_SHORTTEXT|OPT_SEASON_STEXTITLE);
-        xevent=import.AddXMLTVEvent(source,db,ChannelID,Event,Event->Description(),useeptext);
-        if (!xevent)
-        {
-            free((void*)ChannelID);
-            return false;
-        }
-    }
-    else
-    {
-        source=sources->GetSource(xevent->Source());
-    }
-    free((void*)ChannelID);
-    if (!source)
-    {
-        tsyslog("no source for %s",xevent->Source());
-        delete xevent;
-        return false;
-    }
-
-    import.PutEvent(source,db,NULL,Event,xevent,Flags);
-    delete xevent;
-    return false; // let other handlers change this event
+    if (!fps) return false;
+    timerfp key;
+    key.timer=Timer;
+    timerfp *last=(timerfp *) bsearch(&key,fps,numfps,sizeof(timerfp),comparefp);
+    return (last && last->fp==Fp);
 }
 
-bool cEPGHandler::SortSchedule(cSchedule* UNUSED(Schedule))
+void cEPGTimer::savefps()
 {
-    if (db)
+    // remember the events as they are now (after PutEvent!)
+    free(fps);
+    numfps=0;
+    fps=(timerfp *) malloc((Timers.Count()+1)*sizeof(timerfp));
+    if (!fps) return;
+    for (cTimer *Timer = Timers.First(); Timer; Timer = Timers.Next(Timer))
     {
-        import.Commit(NULL,db);
-        sqlite3_close(db);
-        db=NULL;
+        const cEvent *event=Timer->Event();
+        if (!event) continue;
+        fps[numfps].timer=Timer;
+        fps[numfps].fp=fingerprint(event);
+        numfps++;
     }
-    return false; // we dont sort!
+    qsort(fps,numfps,sizeof(timerfp),comparefp);
 }
 
-// -------------------------------------------------------------
-
-cEPGTimer::cEPGTimer(cGlobals *Global) :
-        cThread("xmltv2vdr timer"),import(Global)
+bool cEPGTimer::Changed()
 {
-    sources=Global->EPGSources();
-    maps=Global->EPGMappings();
-    epall=0;
+    // called from the main thread, cheap if nothing changed
+    if (retry || reset) return true;
+    bool check=false;
+    if (Timers.Modified(timersstate)) check=true;
+    time_t modified=cSchedules::Modified();
+    if (modified!=schedulesmodified) check=true;
+    if (!check) return false;
+
+    // the schedules change with every eit update, so only
+    // start the thread if the event of a timer is new or changed
+    cSchedulesLock schedulesLock(false,10); // wait 10ms for lock!
+    if (!cSchedules::Schedules(schedulesLock))
+    {
+        schedulesmodified=0; // check again next time
+        return false;
+    }
+    schedulesmodified=modified;
+    for (cTimer *Timer = Timers.First(); Timer; Timer = Timers.Next(Timer))
+    {
+        const cEvent *event=Timer->Event();
+        if (!event) continue;
+        if (!unchanged(Timer,fingerprint(event))) return true;
+    }
+    return false;
 }
 
 void cEPGTimer::Action()
@@ -570,23 +542,37 @@ void cEPGTimer::Action()
         dsyslog("failed to set ioprio to 3,7");
     }
 
+    retry=true; // if we cannot get the locks
     cSchedulesLock schedulesLock(true,10); // wait 10ms for lock!
     const cSchedules *schedules = cSchedules::Schedules(schedulesLock);
     if (!schedules) return;
 
     if (Timers.BeingEdited()) return;
     Timers.IncBeingEdited();
+    retry=false;
+    if (reset)
+    {
+        free(fps);
+        fps=NULL;
+        numfps=0;
+        reset=false;
+    }
 
     sqlite3 *db=NULL;
+    cEPGMappingsReader reader(maps);
     cEPGSource *source=sources->GetSource(EITSOURCE);
     bool useeptext=((epall & EPLIST_USE_STEXTITLE)==EPLIST_USE_STEXTITLE);
     int Flags=USE_SEASON;
     if (useeptext) Flags|=(USE_SHORTTEXT|OPT_SEASON_STEXTITLE);
+
+    // collect the candidates first, they are resolved per channel
+    cVector<cEvent *> events;
     for (cTimer *Timer = Timers.First(); Timer; Timer = Timers.Next(Timer))
     {
         if (Timer->Recording()) continue; // to late ;)
         cEvent *event=(cEvent *) Timer->Event();
         if (!event) continue;
+        if (unchanged(Timer,fingerprint(event))) continue; // already done
         if (!useeptext)
         {
             if (!event->ShortText() && !event->Description()) continue; // no text -> no episode
@@ -595,37 +581,76 @@ void cEPGTimer::Action()
                 if ((strlen(event->ShortText())+strlen(event->Description()))==0) continue; // no text -> no episode
             }
         }
-        if (maps->ProcessChannel(event->ChannelID()) && event->ShortText()) continue; // already processed by xmltv2vdr
+        if (reader->ProcessChannel(event->ChannelID()) && event->ShortText()) continue; // already processed by xmltv2vdr
+        events.Append(event);
+    }
+    if (!events.Size())
+    {
+        savefps();
+        Timers.DecBeingEdited();
+        return;
+    }
+    events.Sort(CompareEventChannel);
+
+    int channels=0,found=0,added=0;
+    cXMLTVEvent *xevents[EPGTIMER_MAXBATCH];
+    for (int start=0; start<events.Size(); )
+    {
+        int end=start+1;
+        while ((end<events.Size()) && (end-start<EPGTIMER_MAXBATCH) &&
+                (events[end]->ChannelID()==events[start]->ChannelID())) end++;
+        channels++;
 
-        const char *ChannelID=strdup(*event->ChannelID().ToString());
-        cXMLTVEvent *xevent=import.SearchXMLTVEvent(&db,ChannelID,event);
-        if (!xevent)
+        const char *ChannelID=strdup(*events[start]->ChannelID().ToString());
+        int cnt=import.SearchXMLTVEvents(&db,ChannelID,&events[start],xevents,end-start,Flags);
+        if (cnt==-1)
         {
-            xevent=import.AddXMLTVEvent(source,db,ChannelID,event,event->Description(),useeptext);
-            if (!xevent)
+            // batched query failed -> one query per event
+            for (int i=start; i<end; i++)
             {
-                free((void*)ChannelID);
-                continue;
+                xevents[i-start]=import.SearchXMLTVEvent(&db,ChannelID,events[i],Flags);
             }
         }
-        else
+        for (int i=start; i<end; i++)
         {
-            if (!event->ShortText() && event->Description())
+            cEvent *event=events[i];
+            cXMLTVEvent *xevent=xevents[i-start];
+            if ((i>start) && (event==events[i-1]))
+            {
+                // two timers for the same event
+                if (xevent) delete xevent;
+                continue;
+            }
+            if (!xevent)
+            {
+                // episode lookup only for the misses
+                xevent=import.AddXMLTVEvent(source,db,ChannelID,event,event->Description(),useeptext);
+                if (!xevent) continue;
+                added++;
+            }
+            else
             {
-                import.AddShortTextFromEITDescription(xevent,event->Description());
+                found++;
+                if (!event->ShortText() && event->Description())
+                {
+                    import.AddShortTextFromEITDescription(xevent,event->Description());
+                }
             }
+            import.PutEvent(source,db,NULL,event,xevent,Flags);
+            delete xevent;
         }
         free((void*)ChannelID);
-
-        import.PutEvent(source,db,NULL,event,xevent,Flags);
-        delete xevent;
+        start=end;
     }
     if (db)
     {
         import.Commit(source,db);
+        import.FinalizeStatements();
         sqlite3_close(db);
     }
+    savefps();
     Timers.DecBeingEdited();
+    dsyslog("timer events: %i on %i channels, %i found, %i added",events.Size(),channels,found,added);
 }
 
 // -------------------------------------------------------------
@@ -633,44 +658,81 @@ void cEPGTimer::Action()
 cHouseKeeping::cHouseKeeping(cGlobals *Global): cThread("xmltv2vdr housekeeping")
 {
     global=Global;
+    imgdir=NULL;
+}
+
+cHouseKeeping::~cHouseKeeping()
+{
+    if (imgdir) delete imgdir;
 }
 
-void cHouseKeeping::checkdir(const char* imgdir, int age, int &cnt, int &lcnt)
+bool cHouseKeeping::scanslice(cPicDir *Dir, time_t tmin, sqlite3_stmt *Index, int &cnt, int &lcnt)
 {
-    if (age<=0) return;
-    DIR *dir=opendir(imgdir);
-    if (!dir) return;
-    time_t tmin=time(NULL);
-    tmin-=(age*86400);
-    struct dirent dirent_buf,*dirent;
-
-    while (readdir_r(dir,&dirent_buf,&dirent)==0)
-    {
-        if (!dirent) break;
-        if (dirent->d_name[0]=='.') continue;
-        if ((dirent->d_type==DT_LNK) || (dirent->d_type==DT_REG))
+    // continues the scan of the last run, returns true at the end of the directory
+    int fd=Dir->Fd();
+    if (fd==-1) return true;
+    for (int i=1; i<=HOUSEKEEPING_SCANMAX; i++)
+    {
+        if (!Running()) return false;
+        unsigned char type;
+        const char *name=Dir->Next(type);
+        if (!name) return true;
+        if ((type!=DT_LNK) && (type!=DT_REG) && (type!=DT_UNKNOWN)) continue;
+
+        struct stat statbuf;
+        if (fstatat(fd,name,&statbuf,AT_SYMLINK_NOFOLLOW)==-1) continue;
+        if (!S_ISLNK(statbuf.st_mode) && !S_ISREG(statbuf.st_mode)) continue;
+        bool link=S_ISLNK(statbuf.st_mode);
+        if (link && Index)
         {
-            struct stat statbuf;
-            char *fpath;
-            if (asprintf(&fpath,"%s/%s",imgdir,dirent->d_name)!=-1)
+            // the linker doesn't touch a link which is still in use, it only
+            // refreshes the index -> expired there, we just add missing names
+            sqlite3_bind_text(Index,1,name,-1,SQLITE_STATIC);
+            sqlite3_bind_int64(Index,2,statbuf.st_mtime);
+            sqlite3_step(Index);
+            sqlite3_reset(Index);
+        }
+        else
+        {
+            // without index a link lives as long as its picture
+            if (link && (fstatat(fd,name,&statbuf,0)==-1)) continue;
+            if (statbuf.st_mtime<tmin)
             {
-                if (stat(fpath,&statbuf)!=-1)
+                if (unlinkat(fd,name,0)!=-1)
                 {
-                    if (statbuf.st_mtime<tmin)
-                    {
-                        if (unlink(fpath)!=-1)
-                        {
-                            if (dirent->d_type==DT_LNK) lcnt++;
-                            if (dirent->d_type==DT_REG) cnt++;
-                        }
-                    }
+                    if (link) lcnt++;
+                    else cnt++;
                 }
-                free(fpath);
             }
         }
+        if (!(i % 256)) cCondWait::SleepMs(10); // spread the I/O
     }
-    closedir(dir);
-    return;
+    return false;
+}
+
+void cHouseKeeping::expirelinks(sqlite3 *db, int imgfd, time_t tmin, int &lcnt)
+{
+    if (sqlite3_exec(db,IMGINDEX_CREATE,NULL,NULL,NULL)!=SQLITE_OK) return;
+    if (sqlite3_exec(db,"BEGIN IMMEDIATE",NULL,NULL,NULL)!=SQLITE_OK) return; // busy -> next time
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db,"select name from imglinks where linked<?;",-1,&stmt,NULL)==SQLITE_OK)
+    {
+        sqlite3_bind_int64(stmt,1,tmin);
+        while (sqlite3_step(stmt)==SQLITE_ROW)
+        {
+            const char *name=(const char *) sqlite3_column_text(stmt,0);
+            if (name && (unlinkat(imgfd,name,0)!=-1)) lcnt++;
+        }
+        sqlite3_finalize(stmt);
+        if (sqlite3_prepare_v2(db,"delete from imglinks where linked<?;",-1,&stmt,NULL)==SQLITE_OK)
+        {
+            sqlite3_bind_int64(stmt,1,tmin);
+            sqlite3_step(stmt);
+            sqlite3_finalize(stmt);
+        }
+    }
+    sqlite3_exec(db,"COMMIT",NULL,NULL,NULL);
 }
 
 int sd_select(const dirent* dirent)
@@ -683,46 +745,153 @@ int sd_select(const dirent* dirent)
     return 0;
 }
 
-void cHouseKeeping::Action()
+void cHouseKeeping::cleanimages(sqlite3 *db)
 {
-    if (global->ImgDelAfter() && global->ImgDir())
+    // links in imgdir are expired with the age index (filled by the
+    // picture linker). The index may miss links (older versions, a full
+    // linker queue, a recreated epg.db), so imgdir is also scanned in
+    // slices, one per run, which adds the missing links to the index.
+    // The pictures in the source directories are not known to us, these
+    // directories are scanned in slices too.
+    time_t tmin=time(NULL)-(global->ImgDelAfter()*86400);
+    int cnt=0,lcnt=0;
+
+    if (!imgdir) imgdir=new cPicDir(global->ImgDir());
+    if (imgdir->Fd()==-1) return;
+
+    if (db) expirelinks(db,imgdir->Fd(),tmin,lcnt);
+
+    sqlite3_stmt *index=NULL;
+    if (db)
+    {
+        sqlite3_exec(db,"BEGIN",NULL,NULL,NULL);
+        sqlite3_prepare_v2(db,"insert or ignore into imglinks values (?,?);",-1,&index,NULL);
+    }
+    scanslice(imgdir,tmin,index,cnt,lcnt);
+    if (index) sqlite3_finalize(index);
+    if (db) sqlite3_exec(db,"COMMIT",NULL,NULL,NULL);
+
+    struct dirent **names;
+    int ret=scandir(EPGSOURCES,&names,sd_select,alphasort);
+    if (ret>0)
     {
-        int cnt=0,lcnt=0;
-        checkdir(global->ImgDir(),global->ImgDelAfter(),cnt,lcnt);
-        struct dirent **names;
-        int ret=scandir("/var/lib/epgsources",&names,sd_select,alphasort);
-        if (ret>0)
+        for (int i=0; i<ret; i++)
         {
-            for (int i=0; i<ret; i++)
+            char *newdir;
+            if (asprintf(&newdir,"%s/%s",EPGSOURCES,names[i]->d_name)!=-1)
             {
-                char *newdir;
-                if (asprintf(&newdir,"/var/lib/epgsources/%s",names[i]->d_name)!=-1)
+                cPicDir *dir;
+                for (dir=srcdirs.First(); dir; dir=srcdirs.Next(dir))
                 {
-                    checkdir(newdir,global->ImgDelAfter(),cnt,lcnt);
-                    free(newdir);
+                    if (!strcmp(dir->Path(),newdir)) break;
                 }
+                if (!dir)
+                {
+                    dir=new cPicDir(newdir);
+                    srcdirs.Add(dir);
+                }
+                free(newdir);
+                scanslice(dir,tmin,NULL,cnt,lcnt);
             }
-            free(names);
+            free(names[i]);
         }
-        if (lcnt)
+        free(names);
+    }
+    if (lcnt)
+    {
+        isyslog("removed %i links",lcnt);
+    }
+    if (cnt)
+    {
+        isyslog("removed %i pics",cnt);
+    }
+}
+
+int cHouseKeeping::pragma(sqlite3 *db, const char *sql)
+{
+    int ret=-1;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db,sql,-1,&stmt,NULL)==SQLITE_OK)
+    {
+        if (sqlite3_step(stmt)==SQLITE_ROW) ret=sqlite3_column_int(stmt,0);
+        sqlite3_finalize(stmt);
+    }
+    return ret;
+}
+
+void cHouseKeeping::maintaindb(sqlite3 *db)
+{
+    char *errmsg;
+    if (!pragma(db,"PRAGMA auto_vacuum;"))
+    {
+        // old database without auto_vacuum, this needs one full VACUUM
+        isyslog("converting %s to incremental vacuum",global->EPGFile());
+        if (sqlite3_exec(db,"PRAGMA auto_vacuum=INCREMENTAL; VACUUM;",NULL,NULL,&errmsg)!=SQLITE_OK)
         {
-            isyslog("removed %i links",lcnt);
+            esyslog("sqlite3: VACUUM %s",errmsg);
+            sqlite3_free(errmsg);
         }
-        if (cnt)
+    }
+
+    // give free pages back in small steps, so we never block the db for long
+    int freepages=pragma(db,"PRAGMA freelist_count;");
+    for (int i=0; (i<HOUSEKEEPING_VACUUMSTEPS) && (freepages>0) && Running(); i++)
+    {
+        if (sqlite3_exec(db,"PRAGMA incremental_vacuum(" HOUSEKEEPING_VACUUMPAGES ");",
+                         NULL,NULL,NULL)!=SQLITE_OK) break;
+        freepages=pragma(db,"PRAGMA freelist_count;");
+        cCondWait::SleepMs(50);
+    }
+
+    if (cParse::NeedsAnalyze(db))
+    {
+        if (sqlite3_exec(db,"ANALYZE epg;",NULL,NULL,&errmsg)!=SQLITE_OK)
         {
-            isyslog("removed %i pics",cnt);
+            esyslog("sqlite3: ANALYZE %s",errmsg);
+            sqlite3_free(errmsg);
         }
     }
 
-    if (!global->DBExists()) return;
-
-    cSchedulesLock schedulesLock(true,10); // wait 10ms for lock!
-    const cSchedules *schedules = cSchedules::Schedules(schedulesLock);
-    if (!schedules) return;
+    int pages=pragma(db,"PRAGMA page_count;");
+    int pagesize=pragma(db,"PRAGMA page_size;");
+    if ((pages>0) && (pagesize>0) && (freepages>=0))
+    {
+        dsyslog("%s has %.1f MB, %i%% free pages",global->EPGFile(),
+                (double) pages*pagesize/(1024*1024),(freepages*100)/pages);
+    }
+}
 
+void cHouseKeeping::Action()
+{
     sqlite3 *db=NULL;
-    if (sqlite3_open_v2(global->EPGFile(),&db,SQLITE_OPEN_READWRITE,NULL)==SQLITE_OK)
+    if (global->DBExists())
+    {
+        if (sqlite3_open_v2(global->EPGFile(),&db,SQLITE_OPEN_READWRITE,NULL)!=SQLITE_OK)
+        {
+            sqlite3_close(db);
+            db=NULL;
+        }
+        else
+        {
+            sqlite3_busy_timeout(db,1000);
+        }
+    }
+
+    global->EPGMappingSnapshots()->Reclaim();
+    if (global->ImgDelAfter() && global->ImgDir()) cleanimages(db);
+
+    if (!db) return;
+
     {
+        // the schedules lock is only held for the delete
+        cSchedulesLock schedulesLock(true,10); // wait 10ms for lock!
+        const cSchedules *schedules = cSchedules::Schedules(schedulesLock);
+        if (!schedules)
+        {
+            sqlite3_close(db);
+            return;
+        }
+
         char *sql;
         if (asprintf(&sql,"delete from epg where ((starttime+duration) < %li)",time(NULL))!=-1)
         {
@@ -738,12 +907,14 @@ void cHouseKeeping::Action()
                 if (changes)
                 {
                     isyslog("removed %i old entries from db",changes);
-                    sqlite3_exec(db,"VACCUM;",NULL,NULL,NULL);
                 }
             }
             free(sql);
         }
     }
+
+    // vacuum and analyze may take a while, without the schedules lock
+    maintaindb(db);
     sqlite3_close(db);
 }
 
@@ -803,6 +974,17 @@ cPluginXmltv2vdr::~cPluginXmltv2vdr()
 #if VDRVERSNUM < 10726 && (!EPGHANDLER)
     delete g.epghandler;
 #endif
+    if (logwriter)
+    {
+        cLogWriter *writer=logwriter;
+        logwriter=NULL;
+        delete writer; // writes the lines logged after Stop()
+    }
+    if (logfile)
+    {
+        free(logfile);
+        logfile=NULL;
+    }
 }
 
 void cPluginXmltv2vdr::GetSqliteCompileOptions()
@@ -879,7 +1061,9 @@ const char *cPluginXmltv2vdr::CommandLineHelp(void)
            "  -i DIR    --images=DIR   location of epgimages\n"
            "                           (default is /var/cache/vdr/epgimages)\n"
            "  -l FILE   --logfile=FILE write trace logs into the given FILE (default is\n"
-           "                           no trace log\n";
+           "                           no trace log), FILE is moved to FILE.1 at 20 MB\n"
+           "  -t N      --threads=N    match events of N channels in parallel during\n"
+           "                           the import (default is 1)\n";
 }
 
 bool cPluginXmltv2vdr::ProcessArgs(int argc, char *argv[])
@@ -891,11 +1075,12 @@ bool cPluginXmltv2vdr::ProcessArgs(int argc, char *argv[])
         { "epgfile",      required_argument, NULL, 'E'},
         { "images",       required_argument, NULL, 'i'},
         { "logfile",      required_argument, NULL, 'l'},
+        { "threads",      required_argument, NULL, 't'},
         { 0,0,0,0 }
     };
 
     int c;
-    while ((c = getopt_long(argc, argv, "l:e:E:i:", long_options, NULL)) != -1)
+    while ((c = getopt_long(argc, argv, "l:e:E:i:t:", long_options, NULL)) != -1)
     {
         switch (c)
         {
@@ -911,6 +1096,9 @@ bool cPluginXmltv2vdr::ProcessArgs(int argc, char *argv[])
             if (logfile) free(logfile);
             logfile=strdup(optarg);
             break;
+        case 't':
+            g.SetImportThreads(atoi(optarg));
+            break;
         default:
             return false;
         }
@@ -928,6 +1116,12 @@ bool cPluginXmltv2vdr::Start(void)
 {
     // Start any background activities the plugin shall perform.
     g.SetConfDir(ConfigDirectory(PLUGIN_NAME_I18N));
+    if (logfile)
+    {
+        logwriter=new cLogWriter(logfile);
+        if (logwriter) logwriter->Start();
+    }
+    g.ContentMappings()->ReadIn(g.ConfDir());
 
     isyslog("using codeset '%s'",g.Codeset());
     isyslog("using file '%s' for epg database",g.EPGFile());
@@ -940,9 +1134,15 @@ bool cPluginXmltv2vdr::Start(void)
     {
         g.AllocateEPGTimerThread();
     }
-    if (g.ImgDir()) isyslog("using dir '%s' for epgimages (%i)",g.ImgDir(),g.ImgDelAfter());
+    if (g.ImgDir())
+    {
+        isyslog("using dir '%s' for epgimages (%i)",g.ImgDir(),g.ImgDelAfter());
+        g.AllocatePictureLinker();
+        if (g.PictureLinker()) g.PictureLinker()->Start();
+    }
 
     g.EPGSources()->ReadIn(&g);
+    g.PublishEPGMappings(); // all channel.* entries are read now
     g.epghandler = new cEPGHandler(&g);
     g.SetEPAll(g.EPAll());
     isyslog("using sqlite v%s",sqlite3_libversion());
@@ -958,11 +1158,8 @@ void cPluginXmltv2vdr::Stop(void)
     epgexecutor.Stop();
     housekeeping.Stop();
     cParse::CleanupLibXML();
-    if (logfile)
-    {
-        free(logfile);
-        logfile=NULL;
-    }
+    // other threads may still log, the writer lives until the plugin is destroyed
+    if (logwriter) logwriter->Stop(); // writes the rest
 }
 
 void cPluginXmltv2vdr::Housekeeping(void)
@@ -1001,12 +1198,13 @@ void cPluginXmltv2vdr::MainThreadHook(void)
               last_epcheck_t=(now/900)*900;
           }
         */
-        if (g.EPAll())
+        if (g.EPAll() && g.EPGTimer())
         {
-            if (now>=(last_timer_t+600))
+            // only if timers or schedules changed, idle boxes do nothing
+            if (now>=(last_timer_t+EPGTIMER_CHECK))
             {
-                if (g.EPGTimer()) g.EPGTimer()->Start();
-                last_timer_t=(now/600)*600;
+                if (!g.EPGTimer()->Active() && g.EPGTimer()->Changed()) g.EPGTimer()->Start();
+                last_timer_t=now;
             }
         }
     }
@@ -1116,6 +1314,9 @@ const char **cPluginXmltv2vdr::SVDRPHelpPages(void)
         "    Start housekeeping manually\n",
         "TIMR\n"
         "    Start timerthread manually\n",
+        "STAT [reset]\n"
+        "    Show import statistics, one \"<name> <counter> <value>\" per line,\n"
+        "    reset clears the counters afterwards\n",
         NULL
     };
     return HelpPages;
@@ -1174,6 +1375,7 @@ cString cPluginXmltv2vdr::SVDRPCommand(const char *Command, const char *Option,
             }
             else
             {
+                g.DBChanged();
                 ReplyCode=250;
                 output="database deleted\n";
             }
@@ -1188,8 +1390,9 @@ cString cPluginXmltv2vdr::SVDRPCommand(const char *Command, const char *Option,
     {
         if (!epgexecutor.Active() && g.EPGTimer() && !g.EPGTimer()->Active())
         {
+            g.EPGTimer()->Reset();
             g.EPGTimer()->Start();
-            last_timer_t=(time(NULL)/600)*600;
+            last_timer_t=time(NULL);
             ReplyCode=250;
             output="timerthread started\n";
         }
@@ -1207,6 +1410,24 @@ cString cPluginXmltv2vdr::SVDRPCommand(const char *Command, const char *Option,
             }
         }
     }
+    if (!strcasecmp(Command,"STAT"))
+    {
+        output="";
+        for (cEPGSource *src=g.EPGSources()->First(); src; src=g.EPGSources()->Next(src))
+        {
+            src->Stats()->Print(src->Name(),output);
+        }
+        g.HandlerStats()->Print(output);
+        if (Option && !strcasecmp(Option,"reset"))
+        {
+            for (cEPGSource *src=g.EPGSources()->First(); src; src=g.EPGSources()->Next(src))
+            {
+                src->Stats()->Reset();
+            }
+            g.HandlerStats()->Reset();
+        }
+        ReplyCode=250;
+    }
     if (!strcasecmp(Command,"HOUS"))
     {
         if (!epgexecutor.Active() && !housekeeping.Active())
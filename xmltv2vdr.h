@@ -9,11 +9,15 @@
 #define _XMLTV2VDR_H
 
 #include <sqlite3.h>
+#include <stdint.h>
 #include <vdr/plugin.h>
 #include "maps.h"
 #include "parse.h"
 #include "import.h"
 #include "source.h"
+#include "pics.h"
+#include "offsets.h"
+#include "stats.h"
 
 #if __GNUC__ > 3
 #define UNUSED(v) UNUSED_ ## v __attribute__((unused))
@@ -55,23 +59,48 @@ public:
     bool DisableSearchTimer();
 };
 
+#define EPGTIMER_MAXBATCH 256
+#define EPGTIMER_CHECK 60 // seconds between checks for changed timers/schedules
+
 class cEPGTimer : public cThread
 {
 private:
+    struct timerfp
+    {
+        const cTimer *timer;
+        uint64_t fp;
+    };
     cEPGSources *sources;
-    cEPGMappings *maps;
+    cEPGMappingSnapshots *maps;
     cImport import;
     int epall;
+    int timersstate;
+    time_t schedulesmodified;
+    timerfp *fps; // fingerprints of the last run, sorted by timer
+    int numfps;
+    bool retry;
+    bool reset;
+    static int comparefp(const void *a, const void *b);
+    static uint64_t fingerprint(const cEvent *Event);
+    bool unchanged(const cTimer *Timer, uint64_t Fp);
+    void savefps();
 public:
     cEPGTimer(cGlobals *Global);
+    ~cEPGTimer();
     void Stop()
     {
         Cancel(3);
     }
     void SetEPAll(int Value)
     {
+        if (epall!=Value) reset=true;
         epall=Value;
     }
+    void Reset()
+    {
+        reset=true; // process all timers on the next run
+    }
+    bool Changed();
     virtual void Action();
 };
 
@@ -108,18 +137,53 @@ class cEPGSources;
 class cImport;
 class cPluginXmltv2vdr;
 
+#define EPGHANDLER_EVENTS 32768 // entries of the handled events cache, power of two
+#define EPGHANDLER_DBCHECK 10 // seconds between two checks for epg.db
+
+class cEPGEventCache
+{
+private:
+    // eit events as the handler left them (with or without xmltv event),
+    // a repeat is skipped until the event or the database generation changes
+    struct entry
+    {
+        tChannelID channelid;
+        tEventID eventid;
+        time_t start;
+        uint64_t fingerprint;
+        uint32_t generation;
+        bool used;
+    } entries[EPGHANDLER_EVENTS];
+    static uint64_t fingerprint(const cEvent *Event);
+    struct entry *slot(const cEvent *Event);
+public:
+    cEPGEventCache();
+    bool Lookup(const cEvent *Event, uint32_t Generation);
+    void Add(const cEvent *Event, uint32_t Generation);
+};
+
 class cEPGHandler : public cEpgHandler
 {
 private:
-    cEPGMappings *maps;
+    cGlobals *g;
+    cEPGEventCache eventcache;
+    cEPGMappingSnapshots *maps;
     cEPGSources *sources;
     cImport import;
+    cHandlerStats *stats;
+    cXMLTVEvent row; // reused for every found event
     int epall;
     sqlite3 *db;
     time_t now;
-    bool check4proc(cEvent *event, bool &spth, cEPGMapping **map);
+    bool dbexists;
+    time_t dbchecked;
+    uint32_t dbgeneration;
+    bool checkdb();
+    void closedb();
+    bool check4proc(cEvent *event, bool &spth, cEPGMappingsReader &reader, cEPGMapping **map);
 public:
     cEPGHandler(cGlobals *Global);
+    ~cEPGHandler();
     void SetEPAll(int Value)
     {
         epall=Value;
@@ -135,13 +199,24 @@ public:
     virtual bool SortSchedule(cSchedule *Schedule);
 };
 
+#define HOUSEKEEPING_SCANMAX 5000 // max. directory entries per run
+#define HOUSEKEEPING_VACUUMPAGES "256" // pages per incremental_vacuum step
+#define HOUSEKEEPING_VACUUMSTEPS 16
+
 class cHouseKeeping : public cThread
 {
 private:
     cGlobals *global;
-    void checkdir(const char *imgdir, int age, int &cnt, int &lcnt);
+    cPicDir *imgdir;
+    cList<cPicDir> srcdirs;
+    bool scanslice(cPicDir *Dir, time_t tmin, sqlite3_stmt *Index, int &cnt, int &lcnt);
+    void expirelinks(sqlite3 *db, int imgfd, time_t tmin, int &lcnt);
+    void cleanimages(sqlite3 *db);
+    int pragma(sqlite3 *db, const char *sql);
+    void maintaindb(sqlite3 *db);
 public:
     cHouseKeeping(cGlobals *Global);
+    ~cHouseKeeping();
     void Stop()
     {
         Cancel(3);
@@ -175,18 +250,34 @@ private:
     char *srcorder;
     int epall;
     int imgdelafter;
+    int importthreads;
     bool wakeup;
     bool soundex;
+    uint32_t dbgeneration;
     cEPGMappings epgmappings;
+    cEPGMappingSnapshots epgmappingsnapshots;
     cTEXTMappings textmappings;
+    cContentMappings contentmappings;
+    cTimeOffsets timeoffsets;
+    cHandlerStats handlerstats;
     cEPGSources epgsources;
     cEPGTimer *epgtimer;
     cEPGSeasonEpisode *epgseasonepisode;
+    cPictureLinker *piclinker;
 public:
     cGlobals();
     ~cGlobals();
     cEPGHandler *epghandler;
     bool DBExists();
+    void DBChanged()
+    {
+        // epg.db got new content, cached lookups are invalid
+        __sync_fetch_and_add(&dbgeneration,1);
+    }
+    uint32_t DBGeneration()
+    {
+        return __sync_fetch_and_add(&dbgeneration,0);
+    }
     char *GetDefaultOrder();
     void AllocateEPGTimerThread()
     {
@@ -196,6 +287,14 @@ public:
     {
         epgseasonepisode=new cEPGSeasonEpisode(this);
     }
+    void AllocatePictureLinker()
+    {
+        if (imgdir) piclinker=new cPictureLinker(imgdir,epgfile);
+    }
+    cPictureLinker *PictureLinker()
+    {
+        return piclinker;
+    }
     cEPGSeasonEpisode *EPGSeasonEpisode()
     {
         return epgseasonepisode;
@@ -208,10 +307,31 @@ public:
     {
         return &epgmappings;
     }
+    cEPGMappingSnapshots *EPGMappingSnapshots()
+    {
+        return &epgmappingsnapshots;
+    }
+    void PublishEPGMappings()
+    {
+        epgmappingsnapshots.Publish(&epgmappings,&textmappings,order);
+        DBChanged(); // other flags -> other results
+    }
     cTEXTMappings *TEXTMappings()
     {
         return &textmappings;
     }
+    cTimeOffsets *TimeOffsets()
+    {
+        return &timeoffsets;
+    }
+    cContentMappings *ContentMappings()
+    {
+        return &contentmappings;
+    }
+    cHandlerStats *HandlerStats()
+    {
+        return &handlerstats;
+    }
     cEPGSources *EPGSources()
     {
         return &epgsources;
@@ -281,6 +401,7 @@ public:
     void SetEPAll(int Value)
     {
         epall=Value;
+        DBChanged();
         if (epghandler) epghandler->SetEPAll(Value);
         if (!epgtimer)
         {
@@ -295,6 +416,14 @@ public:
     {
         return epall;
     }
+    void SetImportThreads(int Value)
+    {
+        importthreads=(Value<1) ? 1 : ((Value>IMPORT_MAXTHREADS) ? IMPORT_MAXTHREADS : Value);
+    }
+    int ImportThreads()
+    {
+        return importthreads;
+    }
     void SetWakeUp(bool Value)
     {
         wakeup=Value;
@@ -306,6 +435,7 @@ public:
     void SetSoundEx()
     {
         soundex=true;
+        DBChanged();
     }
     bool SoundEx()
     {